@@ -0,0 +1,351 @@
+#include "bench.h"
+#include "command.h"
+#include "utility.h"
+#include "timer.h"
+#include "pmu.h"
+#include "machine.h"
+#include "job.h"
+#include "crc.h"
+#include "sha256.h"
+
+#define BENCH_NAME_WIDTH 16
+#define BENCH_FORMAT_SIZE 64
+
+// Provided by link.ld around the ".benchmarks" section
+extern const bench_t __benchmarks_start[];
+extern const bench_t __benchmarks_end[];
+
+typedef struct {
+    unsigned int iterations; // Operations per trial
+    double cycles, cycles_mad; // Per operation: median and median absolute deviation
+    double ns, ns_mad;
+} bench_result;
+
+unsigned char bench_source[BENCH_BUFFER_SIZE] __attribute__((aligned(64)));
+static unsigned char bench_destination[BENCH_BUFFER_SIZE] __attribute__((aligned(64)));
+static volatile unsigned long bench_sink; // Keeps results the compiler would otherwise drop
+
+static const char *bench_name_list[BENCH_MAX_BENCHMARKS + 1];
+
+/**
+ * Sort a few values in place (insertion sort)
+ */
+static void bench_sort(double *values, int count) {
+    for (int i = 1; i < count; i++) {
+        double value = values[i];
+        int j = i;
+        for (; j > 0 && values[j - 1] > value; j--) {
+            values[j] = values[j - 1];
+        }
+        values[j] = value;
+    }
+}
+
+/**
+ * Median and median absolute deviation of the trials; sorts values
+ */
+static void bench_statistics(double *values, int count, double *median, double *mad) {
+    double deviations[BENCH_TRIALS];
+
+    bench_sort(values, count);
+    *median = values[count / 2];
+    for (int i = 0; i < count; i++) {
+        deviations[i] = values[i] > *median ? values[i] - *median : *median - values[i];
+    }
+    bench_sort(deviations, count);
+    *mad = deviations[count / 2];
+}
+
+/**
+ * Can the benchmark run now?
+ */
+static int bench_available(const bench_t *bench) {
+    return !bench->available || bench->available();
+}
+
+/**
+ * Calibrate, warm up and time one benchmark. Background jobs run at every
+ * poll and may take what the benchmark needs, so it is checked again after.
+ * @return CMD_OK, CMD_ERR_UNAVAILABLE or CMD_ERR_CANCELLED
+ */
+static int bench_measure(const bench_t *bench, bench_result *result) {
+    uint64_t target = timer_usec_to_ticks(BENCH_TRIAL_USEC);
+    double freq = timer_frequency();
+    double cycles[BENCH_TRIALS], ns[BENCH_TRIALS];
+    unsigned int iterations = 1;
+
+    if (!bench_available(bench)) {
+        return CMD_ERR_UNAVAILABLE;
+    }
+
+    // Double the count until a trial is long enough to time precisely
+    for (;;) {
+        uint64_t start = timer_ticks();
+        bench->run(iterations, bench->arg);
+        if (timer_ticks() - start >= target || iterations >= BENCH_MAX_ITERATIONS) {
+            break;
+        }
+        iterations *= 2;
+        if (job_poll()) {
+            return CMD_ERR_CANCELLED;
+        }
+        if (!bench_available(bench)) {
+            return CMD_ERR_UNAVAILABLE;
+        }
+    }
+    bench->run(iterations, bench->arg);
+
+    for (int trial = 0; trial < BENCH_TRIALS; trial++) {
+        if (job_poll()) {
+            return CMD_ERR_CANCELLED;
+        }
+        if (!bench_available(bench)) {
+            return CMD_ERR_UNAVAILABLE;
+        }
+        uint64_t start_cycles = pmu_cycles();
+        uint64_t start_ticks = timer_ticks();
+        bench->run(iterations, bench->arg);
+        uint64_t ticks = timer_ticks() - start_ticks;
+        uint64_t elapsed_cycles = pmu_cycles() - start_cycles;
+
+        cycles[trial] = (double)elapsed_cycles / iterations;
+        ns[trial] = ticks * 1e9 / freq / iterations;
+    }
+
+    result->iterations = iterations;
+    bench_statistics(cycles, BENCH_TRIALS, &result->cycles, &result->cycles_mad);
+    bench_statistics(ns, BENCH_TRIALS, &result->ns, &result->ns_mad);
+    return CMD_OK;
+}
+
+/**
+ * Print one result: a table row, or a key=value record in machine mode
+ */
+static void bench_report(const bench_t *bench, const bench_result *result) {
+    if (machine_mode()) {
+        printf("%s=iterations:%u,cycles:%.2f,cycles_mad:%.2f,ns:%.2f,ns_mad:%.2f", bench->name,
+               result->iterations, result->cycles, result->cycles_mad, result->ns, result->ns_mad);
+        if (bench->bytes) {
+            printf(",mbps:%.1f", bench->bytes * 1e3 / result->ns);
+        }
+        printf("\n");
+        return;
+    }
+
+    printf("%-*.*s %10u %12.1f %9.1f %12.1f %9.1f", BENCH_NAME_WIDTH, BENCH_NAME_WIDTH, bench->name,
+           result->iterations, result->cycles, result->cycles_mad, result->ns, result->ns_mad);
+    if (bench->bytes) {
+        printf(" %10.1f", bench->bytes * 1e3 / result->ns);
+    }
+    printf("\n");
+}
+
+/**
+ * Report a benchmark that could not run, rather than a meaningless time
+ */
+static void bench_report_unavailable(const bench_t *bench) {
+    if (machine_mode()) {
+        printf("%s=unavailable:1\n", bench->name);
+    } else {
+        printf("%-*.*s unavailable: the resource it uses is busy\n", BENCH_NAME_WIDTH, BENCH_NAME_WIDTH, bench->name);
+    }
+}
+
+/**
+ * Does the benchmark match one of the name prefixes (or are there none)?
+ */
+static int bench_selected(const bench_t *bench, int count, char **prefixes) {
+    if (count == 0) {
+        return 1;
+    }
+    for (int i = 0; i < count; i++) {
+        if (strncmp(bench->name, prefixes[i], strlen(prefixes[i])) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static const char *const *completeBenchmarks(int arg, char **argv) {
+    if (!bench_name_list[0]) {
+        int n = 0;
+        for (const bench_t *bench = __benchmarks_start; bench < __benchmarks_end && n < BENCH_MAX_BENCHMARKS; bench++) {
+            bench_name_list[n++] = bench->name;
+        }
+    }
+    return bench_name_list;
+}
+
+static int cmdBench(int argc, char **argv) {
+    if (argc == 2 && strcmp(argv[1], "list") == 0) {
+        for (const bench_t *bench = __benchmarks_start; bench < __benchmarks_end; bench++) {
+            printf(machine_mode() ? "%s\n" : "  %s\n", bench->name);
+        }
+        return CMD_OK;
+    }
+
+    int matched = 0;
+    for (const bench_t *bench = __benchmarks_start; bench < __benchmarks_end; bench++) {
+        if (!bench_selected(bench, argc - 1, argv + 1)) {
+            continue;
+        }
+        if (!matched++ && !machine_mode()) {
+            printf("\n%d trials of about %d us each; median and median absolute deviation per operation\n",
+                   BENCH_TRIALS, BENCH_TRIAL_USEC);
+            printf("Benchmark        Iterations    Cycles/op      +/-         ns/op       +/-       MB/s\n");
+        }
+
+        bench_result result;
+        int status = bench_measure(bench, &result);
+        if (status == CMD_ERR_CANCELLED) {
+            return CMD_ERR_CANCELLED;
+        }
+        if (status == CMD_ERR_UNAVAILABLE) {
+            bench_report_unavailable(bench);
+            continue;
+        }
+        bench_report(bench, &result);
+    }
+
+    if (!matched) {
+        printf("\nNo benchmark matches; 'bench list' shows them\n");
+        return CMD_ERR_INVALID;
+    }
+    return CMD_OK;
+}
+REGISTER_COMMAND_COMPLETE("bench", cmdBench, completeBenchmarks, 0, CMD_MAX_ARGS - 1, "[list | <name>...]",
+                          "Run the kernel microbenchmarks.",
+                          "Runs every registered microbenchmark, or those whose name starts with one of the "
+                          "arguments, and prints the median cost of one operation and its dispersion in cycles "
+                          "and ns. In machine mode each result is a key=value record, for diffing builds. "
+                          "Examples: bench, bench memcpy printf, bench list");
+
+/* General-purpose benchmarks; drivers register theirs next to their code */
+
+static void benchEmpty(unsigned int iterations, unsigned long arg) {
+    for (unsigned int i = 0; i < iterations; i++) {
+        asm volatile("" : : : "memory");
+    }
+}
+REGISTER_BENCHMARK("loop", benchEmpty, 0, 0);
+
+static void benchTimerRead(unsigned int iterations, unsigned long arg) {
+    for (unsigned int i = 0; i < iterations; i++) {
+        bench_sink = arg ? pmu_cycles() : timer_ticks();
+    }
+}
+REGISTER_BENCHMARK("timer_ticks", benchTimerRead, 0, 0);
+REGISTER_BENCHMARK("pmu_cycles", benchTimerRead, 1, 0);
+
+static void benchMemcpy(unsigned int iterations, unsigned long size) {
+    for (unsigned int i = 0; i < iterations; i++) {
+        memcpy(bench_destination, bench_source, size);
+    }
+}
+REGISTER_BENCHMARK("memcpy-64", benchMemcpy, 64, 64);
+REGISTER_BENCHMARK("memcpy-4k", benchMemcpy, 4096, 4096);
+REGISTER_BENCHMARK("memcpy-64k", benchMemcpy, 65536, 65536);
+REGISTER_BENCHMARK("memcpy-1m", benchMemcpy, BENCH_BUFFER_SIZE, BENCH_BUFFER_SIZE);
+
+static void benchMemset(unsigned int iterations, unsigned long size) {
+    for (unsigned int i = 0; i < iterations; i++) {
+        memset(bench_destination, i, size);
+    }
+}
+REGISTER_BENCHMARK("memset-64", benchMemset, 64, 64);
+REGISTER_BENCHMARK("memset-4k", benchMemset, 4096, 4096);
+REGISTER_BENCHMARK("memset-64k", benchMemset, 65536, 65536);
+REGISTER_BENCHMARK("memset-1m", benchMemset, BENCH_BUFFER_SIZE, BENCH_BUFFER_SIZE);
+
+// 64 characters, the length of a long command line
+static const char bench_text[] = "The quick brown fox jumps over the lazy dog; pack my box with 5 ";
+static const char bench_text_copy[] = "The quick brown fox jumps over the lazy dog; pack my box with 5 ";
+
+static void benchString(unsigned int iterations, unsigned long function) {
+    char copy[sizeof(bench_text)];
+
+    for (unsigned int i = 0; i < iterations; i++) {
+        switch (function) {
+        case 0:
+            bench_sink = strlen(bench_text);
+            break;
+        case 1:
+            bench_sink = strcmp(bench_text, bench_text_copy);
+            break;
+        case 2:
+            bench_sink = (unsigned long)strncpy(copy, bench_text, sizeof(copy));
+            break;
+        default:
+            bench_sink = (unsigned long)strstr(bench_text, "with 5");
+            break;
+        }
+    }
+}
+REGISTER_BENCHMARK("strlen-64", benchString, 0, 0);
+REGISTER_BENCHMARK("strcmp-64", benchString, 1, 0);
+REGISTER_BENCHMARK("strncpy-64", benchString, 2, 0);
+REGISTER_BENCHMARK("strstr-64", benchString, 3, 0);
+
+static void benchFormat(char *buffer, const char *format, ...) {
+    va_list args;
+
+    va_start(args, format);
+    printFormatted(buffer, format, args);
+    va_end(args);
+}
+
+// One printFormatted() conversion at a time, into a buffer (nothing is sent)
+static void benchPrintf(unsigned int iterations, unsigned long conversion) {
+    char buffer[BENCH_FORMAT_SIZE];
+
+    for (unsigned int i = 0; i < iterations; i++) {
+        switch (conversion) {
+        case 0:
+            benchFormat(buffer, "%d", -123456789);
+            break;
+        case 1:
+            benchFormat(buffer, "%lu", 12345678901234ul);
+            break;
+        case 2:
+            benchFormat(buffer, "%08x", 0xc0ffee);
+            break;
+        case 3:
+            benchFormat(buffer, "%s", "benchmark");
+            break;
+        case 4:
+            benchFormat(buffer, "%.3f", 3.14159);
+            break;
+        default:
+            benchFormat(buffer, "%c", 'x');
+            break;
+        }
+    }
+}
+REGISTER_BENCHMARK("printf-d", benchPrintf, 0, 0);
+REGISTER_BENCHMARK("printf-lu", benchPrintf, 1, 0);
+REGISTER_BENCHMARK("printf-x", benchPrintf, 2, 0);
+REGISTER_BENCHMARK("printf-s", benchPrintf, 3, 0);
+REGISTER_BENCHMARK("printf-f", benchPrintf, 4, 0);
+REGISTER_BENCHMARK("printf-c", benchPrintf, 5, 0);
+
+static void benchChecksum(unsigned int iterations, unsigned long function) {
+    uint8_t digest[SHA256_DIGEST_SIZE];
+
+    for (unsigned int i = 0; i < iterations; i++) {
+        switch (function) {
+        case 0:
+            bench_sink = crc32(0, bench_source, 4096);
+            break;
+        case 1:
+            bench_sink = crc32c(0, bench_source, 4096);
+            break;
+        default:
+            sha256(bench_source, 4096, digest);
+            bench_sink = digest[0];
+            break;
+        }
+    }
+}
+REGISTER_BENCHMARK("crc32-4k", benchChecksum, 0, 4096);
+REGISTER_BENCHMARK("crc32c-4k", benchChecksum, 1, 4096);
+REGISTER_BENCHMARK("sha256-4k", benchChecksum, 2, 4096);
@@ -0,0 +1,59 @@
+// -----------------------------------bench.h -------------------------------------
+#ifndef BENCH_H
+#define BENCH_H
+
+#include "../gcclib/stdint.h"
+
+/* Microbenchmark registry ('bench').
+ * Each benchmark is a bench_t placed in the ".benchmarks" linker section with
+ * REGISTER_BENCHMARK, next to the code it measures; link.ld collects them
+ * between __benchmarks_start and __benchmarks_end. A benchmark's run function
+ * repeats the measured operation the given number of times. 'bench' doubles
+ * that count until one trial lasts BENCH_TRIAL_USEC (which also warms the
+ * caches and branch predictors), runs one more warmup trial, then
+ * BENCH_TRIALS measured ones, and reports the median cost of one operation
+ * with the median absolute deviation of the trials, in cycles and ns. One that
+ * depends on a shared resource registers with REGISTER_BENCHMARK_IF and is
+ * reported as unavailable, not timed, while its check fails. */
+
+#define BENCH_TRIALS 15
+#define BENCH_TRIAL_USEC 2000
+#define BENCH_MAX_ITERATIONS (1u << 24)
+#define BENCH_MAX_BENCHMARKS 64 // For the name list offered by TAB
+#define BENCH_BUFFER_SIZE (1 << 20) // Largest memcpy/memset size
+
+/* Repeat the operation iterations times; arg comes from the descriptor */
+typedef void (*bench_function)(unsigned int iterations, unsigned long arg);
+
+/* Whether the benchmark can run now (e.g. the resource it uses is free) */
+typedef int (*bench_check)(void);
+
+typedef struct {
+    const char *name;
+    bench_function run;
+    unsigned long arg;   // E.g. a buffer size or a variant number
+    unsigned long bytes; // Bytes moved per operation, for the bandwidth column; 0 for none
+    bench_check available; // NULL when the benchmark can always run
+} bench_t;
+
+/* Source buffer of the memory benchmarks, also read by 'crc bench' and
+ * 'sha256 bench' so they do not hash live kernel data */
+extern unsigned char bench_source[BENCH_BUFFER_SIZE];
+
+#define BENCH_CONCAT_(a, b) a##b
+#define BENCH_CONCAT(a, b) BENCH_CONCAT_(a, b)
+
+#define REGISTER_BENCHMARK_IF(bench_name, bench_run, bench_arg, bench_bytes, bench_available) \
+    static const bench_t BENCH_CONCAT(__benchmark_, __LINE__)                        \
+    __attribute__((used, section(".benchmarks"), aligned(8))) = {                    \
+        .name = bench_name,                                                          \
+        .run = bench_run,                                                            \
+        .arg = bench_arg,                                                            \
+        .bytes = bench_bytes,                                                        \
+        .available = bench_available,                                                \
+    }
+
+#define REGISTER_BENCHMARK(bench_name, bench_run, bench_arg, bench_bytes) \
+    REGISTER_BENCHMARK_IF(bench_name, bench_run, bench_arg, bench_bytes, 0)
+
+#endif
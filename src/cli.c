@@ -1,299 +1,121 @@
 #include "cli.h"
+#include "command.h"
+#include "complete.h"
 #include "uart.h"
+#include "timer.h"
+#include "crc.h"
+#include "sha256.h"
+#include "pmu.h"
+#include "semihost.h"
+#include "machine.h"
+#include "job.h"
+#include "screen.h"
+#include "bench.h"
 
 #define MAX_CMD_SIZE 100
 #define UART_CLOCK 48000000 // Default UART clock frequency
-
-// Updated command array
-const char *commands[] = {"help", "clear", "setcolor", "showinfo", 
-                        "home", "setbaud", "setdatabits", "setstopbits", 
-                        "setparity", "setflowcontrol", "currentuartsettings"};
-
-// Updated command descriptions array
-const char *commandDescriptions[] = {
-    "Provides assistance in navigating the DoorOS CLI environment.",
-    "Refreshes the terminal by clearing clutter.",
-    "Adjusts text and background colors. Example Usage: setcolor -b yellow -t white.",
-    "Displays board revision and MAC address.",
-    "Return to home.",
-    "Sets the UART baud rate. Example: setbaud 115200",
-    "Sets the UART data bits (5, 6, 7 or 8). Example: setdatabits 8",
-    "Sets the UART stop bits (1 or 2). Example: setstopbits 1",
-    "Sets the UART parity (N for None, E for Even, O for Odd). Example: setparity N",
-    "Sets the UART hardware handshake (N for None, E for Enable). Example: setflowcontrol N",
-};
-
-// Simple isspace implementation
-static inline int isspace(int c) {
-    return (c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\f' || c == '\v');
-}
-
-// Function to convert ASCII string to integer (since we cannot use the standard library's atoi)
+#define SHA256_BENCH_SIZE 65536 // At most BENCH_BUFFER_SIZE
+#define HELP_TABLE_WIDTH 60 // Characters between "| " and the closing "|"
+#define HELP_NAME_WIDTH 16
+#define REPEAT_MAX_RUNS 1000
+#define REPEAT_SLOTS 4 // repeats running at once, nested or in jobs
+#define PERF_NAME_WIDTH 20
+#define TOP_REFRESH_MSEC 500 // Default refresh period of the top dashboard
+#define TOP_FIRST_COMMAND_ROW 10
+
+// Function to convert an argument to an integer (since we cannot use the standard library's atoi);
+// -1 unless the whole argument is a number (see parse_number)
 static int simple_atoi(const char *str) {
-    int res = 0;
-    while (*str >= '0' && *str <= '9') {
-        res = res * 10 + (*str - '0');
-        str++;
-    }
-    return res;
+    unsigned long value;
+    return parse_number(str, &value) && value <= 0x7FFFFFFF ? (int)value : -1;
 }
 
-
 // Process a command from user input
-void processCommand(const char *cmd) {
-    int commandIndex = -1;
+int processCommand(const char *cmd) {
+    char line[MAX_CMD_SIZE];
+    char *argv[CMD_MAX_ARGS];
+    int argc = 0;
     char *saveptr; // For strtok_r
 
-    // Declare variables here
-    const char *options;
-    char *token = NULL;
-    const char *textColor = NULL; // Changed to const char
-    const char *backgroundColor = NULL; // Changed to const char
-
-    // Check if the command is empty or contains only whitespaces
-    const char *p = cmd;
-    while (*p != '\0') {
-        if (!isspace((unsigned char)*p)) {
-            break;
-        }
-        p++;
-    }
-    
-    // If the command is empty or whitespace only, just return to prompt
-    if (*p == '\0') {
-        return;
+    // Split a copy of the line into arguments; strtok_r writes into the buffer
+    strncpy(line, cmd, MAX_CMD_SIZE - 1);
+    line[MAX_CMD_SIZE - 1] = '\0';
+    for (char *token = strtok_r(line, " \t", &saveptr); token != NULL && argc < CMD_MAX_ARGS;
+         token = strtok_r(NULL, " \t", &saveptr)) {
+        argv[argc++] = token;
     }
 
-    // Check if the command starts with "help "
-    if (strncmp(cmd, "help ", 5) == 0) {
-        // Extract the command name (e.g., "help showinfo" -> "showinfo")
-        const char *commandName = cmd + 5;
-        printCommandHelp(commandName);
-        return;
+    // If the command is empty or whitespace only, just return to prompt
+    if (argc == 0) {
+        return CMD_OK;
     }
 
-    // Determine if the command matches a predefined command
-    for (int i = 0; i < sizeof(commands) / sizeof(commands[0]); i++) {
-        if (strncmp(cmd, commands[i], strlen(commands[i])) == 0) {
-            commandIndex = i;
-            break;
+    // A trailing "&" runs the command as a background job
+    if (argc > 1 && strcmp(argv[argc - 1], "&") == 0) {
+        int id = job_spawn(argc - 1, argv);
+        if (id == 0) {
+            printf("\nNo free job slot (%d jobs at most)\n", JOB_MAX);
+            return CMD_ERR_FAILED;
         }
+        printf("\n[%d] %s\n", id, argv[0]);
+        return CMD_OK;
     }
 
-    switch (commandIndex) {
-        case 0:
-            help(); break;
-        case 1:
-            clear(); break;
-        case 2:
-            // Check if the command is "setcolor"
-            if (strncmp(cmd, "setcolor", 7) == 0) {
-                // Extract the options part of the command (e.g., "-b yellow -t white")
-                options = cmd + 8; // Skip "setcolor "
-
-                // Tokenize the options based on spaces using strtok_r
-                token = strtok_r((char *)options, " ", &saveptr);
-
-                while (token != NULL) {
-                    if (strncmp(token, "-b", 2) == 0) {
-                        // Next token is the background color
-                        token = strtok_r((char *)options + 4, " ", &saveptr);
-                        if (token != NULL) {
-                            // Map input color name to ANSI escape code
-                            backgroundColor = mapColorToCodeBackground(token);
-                        }
-                    } else if (strncmp(token, "-t", 2) == 0) {
-                        // Next token is the text color
-                        token = strtok_r((char *)options + 4, " ", &saveptr);
-                        if (token != NULL) {
-                            // Map input color name to ANSI escape code
-                            textColor = mapColorToCodeText(token);
-                        }
-                    }
-                    
-                    options += 4 + strlen(token); // Skip "-b/-t <color> "
-                    token = strtok_r((char *)options + 1, " ", &saveptr);
-                }
-
-                setColor(textColor, backgroundColor);
-            }
-            break;
-        case 3:
-            showInfo(); break;
-        case 4:
-            home();break;
-        case 5:
-            // Set Baud Rate
-            if (strncmp(cmd, "setbaud ", 8) == 0) {
-                // Turn off uart before changing baud rate
-                UART0_CR = 0x0;
-                int baud_rate = simple_atoi(cmd + 8);
-                unsigned int ibrd, fbrd, divider;
-                divider = UART_CLOCK / (16 * baud_rate);
-                ibrd = divider;                       // Integer part of divider
-                fbrd = (divider - ibrd) * 64 + 0.5;   // Fractional part of divider
-
-                UART0_IBRD = ibrd;
-                UART0_FBRD = fbrd;
-                // Restart UART
-                UART0_CR = 0x301;
-                printf("Baud rate set to %d\n", baud_rate);
-            } 
-            break;
-        case 6:
-            // Set Data Bits
-            if (strncmp(cmd, "setdatabits ", 12) == 0) {
-                // Turn off UART0 before changing data bits
-                UART0_CR = 0x0;
-
-                // Parse the number of data bits from the command
-                int data_bits = simple_atoi(cmd + 12);
-                if (data_bits < 5 || data_bits > 8) {
-                    printf("Invalid data bits. Must be between 5 and 8.\n");
-                    return; // Add error handling for invalid data bits
-                }
-
-                // Read current LCRH, clear the data bits field, and set new data bits
-                unsigned int lcrh = UART0_LCRH & ~UART0_LCRH_WLEN_MASK;
-                lcrh |= set_data_bits(data_bits); // Set the new data bits
-
-                // Write the updated value back to the LCRH register
-                UART0_LCRH = lcrh;
-
-                // Re-enable UART0 after configuration
-                UART0_CR = 0x301;UART0_LCRH = lcrh;
-
-                // Print confirmation message
-                printf("Data bits set to %d\n", data_bits);
-            }
-            break;
-        case 7:
-            // Set Stop Bits
-            if (strncmp(cmd, "setstopbits ", 12) == 0) {
-                // Turn off UART0 before changing stop bits
-                UART0_CR = 0x0;
-
-                // Parse the number of stop bits from the command
-                int stop_bits = simple_atoi(cmd + 12);
-                if (stop_bits != 1 && stop_bits != 2) {
-                    printf("Invalid stop bits. Must be 1 or 2.\n");
-                    return; // Add error handling for invalid stop bits
-                }
-
-                // Read current LCRH, clear the stop bits field, and set new stop bits
-                unsigned int lcrh = UART0_LCRH & ~UART0_LCRH_STP2; // Clear the stop bits
-                lcrh |= set_stop_bits(stop_bits); // Set the new stop bits
-
-                
-                // Write the updated value back to the LCRH register
-                UART0_LCRH = lcrh;
-
-                // Re-enable UART0 after configuration
-                UART0_CR = 0x301; UART0_LCRH = lcrh;
-
-                // Print confirmation message
-                printf("Stop bits set to %d\n", stop_bits);
-            }
-            break;
-        case 8:
-            // Set Parity
-            if (strncmp(cmd, "setparity ", 10) == 0) {
-                // Turn off UART0 before changing parity
-                UART0_CR = 0x0;
-
-                // Parse the parity setting from the command
-                char parity = cmd[10]; // Assuming this gets you the correct character for parity
-
-                // Read current LCRH, clear the parity bits, then set new parity
-                unsigned int lcrh = UART0_LCRH & ~(UART0_LCRH_EPS | UART0_LCRH_PEN); // Clear parity bits
-                lcrh |= set_parity(parity); // Apply new parity settings
-
-                // Write the updated value back to the LCRH register
-                UART0_LCRH = lcrh;
-
-                // Re-enable UART0 after configuration
-                UART0_CR = 0x301; UART0_LCRH = lcrh;
-
-                // Print confirmation message based on the parity setting
-                printf("Parity set to %c\n", parity);
-            }
-            break;
-        case 9:
-            // Set Hardware Handshake (CTS/RTS)
-            if (strncmp(cmd, "setflowcontrol ", 15) == 0) {
-                // Turn off UART0 before changing flow control
-                UART0_CR = 0x0;
+    return runCommand(argc, argv);
+}
 
-                // Parse the flow control setting from the command
-                char flow_control = cmd[15]; // Assuming this gets you the correct character for flow control
+// Run an already split command line; also used by meta-commands such as time and repeat
+int runCommand(int argc, char **argv) {
+    const command_t *command = command_find(argv[0]);
+    if (command == NULL) {
+        printf(
+            "\n"
+            "Invalid command.\n"
+            "Type 'help' to display the list of available commands.\n"
+            );
+        return CMD_ERR_UNKNOWN;
+    }
 
-                // Clear the RTS/CTS bits, then set new flow control
-                UART0_CR &= ~(UART0_CR_RTSEN | UART0_CR_CTSEN); // Clear flow control bits
-                UART0_CR |= set_rts_cts(flow_control); // Apply new flow control settings
+    // Check the argument count against the command's schema
+    if (argc - 1 < command->min_args || argc - 1 > command->max_args) {
+        printf("\nUsage: %s %s\n", command->name, command->usage);
+        return CMD_ERR_USAGE;
+    }
 
-                // Re-enable UART0 after configuration
-                UART0_CR |= 0x301; // Reapply the enable bits
+    uint64_t start = pmu_cycles();
+    int status = command->handler(argc, argv);
+    command_record(command, pmu_cycles() - start);
+    return status;
+}
 
-                // Print confirmation message based on the flow control setting
-                printf("Flow control set to %c\n", flow_control);
-            }
-            break;
-        case 10:
-            // Display current UART settings          
-            if (strncmp(cmd, "currentuartsettings", 19) == 0) {
-                
-                printf("\nCurrent UART Settings:\n");
-
-                // Display baud rate
-                unsigned int ibrd = UART0_IBRD;
-                unsigned int fbrd = UART0_FBRD;
-                unsigned int baud_rate = UART_CLOCK / (16 * (ibrd + (fbrd / 64.0)));
-                printf("Baud rate: %d\n", baud_rate);
-
-                // Display FIFO status
-                printf("FIFO: %s\n", (UART0_LCRH & UART0_LCRH_FEN) ? "Enabled" : "Disabled");
-
-                // Display data bits
-                printf("Data bits: ");
-                switch (UART0_LCRH & 0x60) {
-                    case UART0_LCRH_WLEN_5BIT: printf("5\n"); break;
-                    case UART0_LCRH_WLEN_6BIT: printf("6\n"); break;
-                    case UART0_LCRH_WLEN_7BIT: printf("7\n"); break;
-                    case UART0_LCRH_WLEN_8BIT: printf("8\n"); break;
-                    default: printf("Unknown\n"); break;
-                }
-
-                // Display parity
-                if (UART0_LCRH & UART0_LCRH_PEN) {
-                    if (UART0_LCRH & UART0_LCRH_EPS) {
-                        printf("Parity: Even\n");
-                    } else {
-                        printf("Parity: Odd\n");
-                    }
-                } else {
-                    printf("Parity: None\n");
-                }
-
-                // Display stop bits
-                printf("Stop bits: %s\n", (UART0_LCRH & UART0_LCRH_STP2) ? "2" : "1");
-
-                // Display RTS/CTS flow control
-                printf("RTS/CTS flow control: %s\n", (UART0_CR & UART0_CR_RTSEN) ? "Enabled" : "Disabled");
-                
-            }
-            break;
-        default:
-            printf(
-                "\n"
-                "Invalid command.\n"
-                "Type 'help' to display the list of available commands.\n"
-                );
-            break;
+// Function to print one "| name - summary |" row of the help table
+static void printHelpRow(const char *name, const char *summary) {
+    // The name column stretches for a long name; the summary fills (or is cut to) the rest
+    int name_width = strlen(name);
+    if (name_width < HELP_NAME_WIDTH) {
+        name_width = HELP_NAME_WIDTH - 1;
     }
+    int summary_width = HELP_TABLE_WIDTH - name_width - 3;
+    if (summary_width < 0) {
+        summary_width = 0;
+    }
+
+    printf("| %-*s - %-*.*s|\n", name_width, name, summary_width, summary_width, summary);
 }
 
 // Function to display command list
 void help(){
+    const command_t *sorted[CMD_MAX_COMMANDS];
+    int count = command_count();
+
+    // Machine mode: one "name=summary" record per command, in registry order
+    if (machine_mode()) {
+        for (int i = 0; i < count; i++) {
+            printf("%s=%s\n", command_at(i)->name, command_at(i)->summary);
+        }
+        return;
+    }
+
     printf(
     "\n"
     "+-------------------------------------------------------------+\n"
@@ -304,25 +126,47 @@ void help(){
     "|                                                             |\n"
     "| Commands:                                                   |\n"
     "|                                                             |\n"
-    "| home            - Return to home.                           |\n"
-    "| help            - Display this help message.                |\n"
-    "| clear           - Clear the terminal screen.                |\n"
-    "| setcolor        - Set text and background colors.           |\n"
-    "| showinfo        - Display board revision and MAC address.   |\n"
-    "|                                                             |\n"
-    "| setbaud         - Set the UART baud rate.                   |\n"
-    "| setdatabits     - Set the UART data bits.                   |\n"
-    "| setstopbits     - Set the UART stop bits.                   |\n"
-    "| setparity       - Set the UART parity.                      |\n"
-    "| setflowcontrol  - Set the UART hardware handshake.          |\n"
-    "|                                                             |\n"
-    "| currentuartsettings - Display current UART settings.        |\n"
+    );
+
+    // List the registry in alphabetical order (insertion sort)
+    if (count > CMD_MAX_COMMANDS) {
+        count = CMD_MAX_COMMANDS;
+    }
+    for (int i = 0; i < count; i++) {
+        const command_t *command = command_at(i);
+        int j = i;
+        while (j > 0 && strcmp(sorted[j - 1]->name, command->name) > 0) {
+            sorted[j] = sorted[j - 1];
+            j--;
+        }
+        sorted[j] = command;
+    }
+    for (int i = 0; i < count; i++) {
+        printHelpRow(sorted[i]->name, sorted[i]->summary);
+    }
+
+    printf(
     "+-------------------------------------------------------------+\n"
     "\n"
-
     );
 }
 
+static const char *const *completeHelp(int arg, char **argv) {
+    return arg == 1 ? command_names() : NULL;
+}
+
+static int cmdHelp(int argc, char **argv) {
+    if (argc == 2) {
+        printCommandHelp(argv[1]);
+        return command_find(argv[1]) ? CMD_OK : CMD_ERR_UNKNOWN;
+    }
+    help();
+    return CMD_OK;
+}
+REGISTER_COMMAND_COMPLETE("help", cmdHelp, completeHelp, 0, 1, "[command]",
+                 "Display this help message.",
+                 "Provides assistance in navigating the DoorOS CLI environment. Example: help setcolor");
+
 void home() {
     printf("\033[1;31m", "\x1b[40m");
     // show a Welcome Message when the OS successfully boot up
@@ -352,23 +196,22 @@ void home() {
     printf("\033[1;37m", "\x1b[40m");
 }
 
-// Function to print help for a specific command
-void printCommandHelp(const char *cmd) {
-    // Store the original value of commands[2]
-    const char *originalSetcolor = commands[2];
-
-    // Temporarily remove the trailing space
-    commands[2] = "setcolor";
 
-    for (int i = 0; i < sizeof(commands) / sizeof(commands[0]); i++) {
-        if (strncmp(cmd, commands[i], strlen(commands[i])) == 0) {
-            printf("%s\n", commandDescriptions[i]);
+static int cmdHome(int argc, char **argv) {
+    home();
+    return CMD_OK;
+}
+REGISTER_COMMAND("home", cmdHome, 0, 0, "",
+                 "Return to home.",
+                 "Return to home.");
 
-            // Restore the original value of commands[2]
-            commands[2] = originalSetcolor;
+// Function to print help for a specific command
+void printCommandHelp(const char *cmd) {
+    const command_t *command = command_find(cmd);
 
-            return;
-        }
+    if (command) {
+        printf("\n%s\nUsage: %s %s\n", command->help, command->name, command->usage);
+        return;
     }
 
     printf(
@@ -384,6 +227,14 @@ void clear(){
     printf("\033[2J\033[1;1H");
 }
 
+static int cmdClear(int argc, char **argv) {
+    clear();
+    return CMD_OK;
+}
+REGISTER_COMMAND("clear", cmdClear, 0, 0, "",
+                 "Clear the terminal screen.",
+                 "Refreshes the terminal by clearing clutter.");
+
 // Function to set text and background colors
 void setColor(const char *textColor, const char *backgroundColor) {
     if (textColor || backgroundColor) {
@@ -408,13 +259,40 @@ void setColor(const char *textColor, const char *backgroundColor) {
     );
 }
 
+static const char *const *completeSetColor(int arg, char **argv) {
+    static const char *const options[] = {"-b", "-t", NULL};
+    return (arg % 2) ? options : colorNames;
+}
+
+static int cmdSetColor(int argc, char **argv) {
+    const char *textColor = NULL;
+    const char *backgroundColor = NULL;
+
+    // Options come in pairs: -t <color> and/or -b <color>
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "-b") == 0) {
+            backgroundColor = mapColorToCodeBackground(argv[i + 1]);
+        } else if (strcmp(argv[i], "-t") == 0) {
+            textColor = mapColorToCodeText(argv[i + 1]);
+        }
+    }
+
+    setColor(textColor, backgroundColor);
+    return (textColor || backgroundColor) ? CMD_OK : CMD_ERR_INVALID;
+}
+REGISTER_COMMAND_COMPLETE("setcolor", cmdSetColor, completeSetColor, 2, 4, "[-t <color>] [-b <color>]",
+                 "Set text and background colors.",
+                 "Adjusts text and background colors. Example Usage: setcolor -b yellow -t white.");
+
 // Displays board revision
 void showInfo()
 {
-    printf(
-    "\n"
-    "  Board Information\n"
-    "\n");
+    if (!machine_mode()) {
+        printf(
+        "\n"
+        "  Board Information\n"
+        "\n");
+    }
     unsigned int *response = 0;
     unsigned int address[6];
     
@@ -428,68 +306,796 @@ void showInfo()
     address[3] = (response[0] >> 16) & 0xFF; 
     address[4] = (response[0] >> 8) & 0xFF; 
     address[5] = (response[0]) & 0xFF; 
-    printf("  Board MAC address: %x:%x:%x:%x:%x:%x\n\n", address[0], address[1], address[2], address[3], address[4], address[5]);
+    if (machine_mode()) {
+        printf("mac=%02x:%02x:%02x:%02x:%02x:%02x\n", address[0], address[1], address[2], address[3], address[4], address[5]);
+    } else {
+        printf("  Board MAC address: %x:%x:%x:%x:%x:%x\n\n", address[0], address[1], address[2], address[3], address[4], address[5]);
+    }
 
     // Board revision
     mbox_buffer_setup(ADDR(mBuf), MBOX_TAG_GETBOARDREVISION, &response);
     mbox_call(ADDR(mBuf), MBOX_CH_PROP);
-    printf("  Board revision: %x\n\n", response[0]);
+    if (machine_mode()) {
+        printf("revision=%08x\n", response[0]);
+    } else {
+        printf("  Board revision: %x\n\n", response[0]);
+    }
 }
 
 
-// Function to handle command auto-completion and display suggestions
-void autoComplete(char *buffer, int *index) {
-    static int lastMatchIndex = -1;
-    int commandCount = sizeof(commands) / sizeof(commands[0]);
-    int multipleMatches = 0;
+static int cmdShowInfo(int argc, char **argv) {
+    showInfo();
+    return CMD_OK;
+}
+REGISTER_COMMAND("showinfo", cmdShowInfo, 0, 0, "",
+                 "Display board revision and MAC address.",
+                 "Displays board revision and MAC address.");
+
+// Rates offered by TAB completion; any rate uart_valid_baud_rate accepts works
+static const char *const baudRates[] = {
+    "9600", "19200", "38400", "57600", "115200", "230400", "460800", "921600",
+    "1000000", "1500000", "2000000", "3000000", NULL
+};
+
+static const char *const *completeBaudRate(int arg, char **argv) {
+    return arg == 1 ? baudRates : NULL;
+}
 
-    // Find the last space or beginning of the buffer
-    int i;
-    for (i = *index - 1; i >= 0 && buffer[i] != ' '; i--);
+static int cmdSetBaud(int argc, char **argv) {
+    int baud_rate = simple_atoi(argv[1]);
+    if (!uart_valid_baud_rate(baud_rate)) {
+        printf("Invalid baud rate.\n");
+        return CMD_ERR_INVALID;
+    }
 
-    // Extract the word that needs completion
-    char word[MAX_CMD_SIZE];
-    strncpy(word, buffer + i + 1, *index - i - 1);
-    word[*index - i - 1] = '\0';
+    // Confirm at the old rate; the switch drains TX before reprogramming
+    printf("Baud rate set to %d\n", baud_rate);
+    uart_set_console_baud_rate(baud_rate);
+    return CMD_OK;
+}
+REGISTER_COMMAND_COMPLETE("setbaud", cmdSetBaud, completeBaudRate, 1, 1, "<rate>",
+                 "Set the UART baud rate.",
+                 "Sets the UART baud rate. Example: setbaud 115200");
 
-    // Attempt to find the next matching command
-    int start = (lastMatchIndex + 1) % commandCount;
-    int found = 0, firstMatchIndex = -1;
-    for (int j = start; ; j = (j + 1) % commandCount) {
-        if (strstr(commands[j], word) == commands[j]) {
-            if (!found) {
-                firstMatchIndex = j;
-            }
-            found++;
-            if (found > 1) {
-                multipleMatches = 1;
-                break;
+static const char *const *completeDataBits(int arg, char **argv) {
+    static const char *const values[] = {"5", "6", "7", "8", NULL};
+    return arg == 1 ? values : NULL;
+}
+
+static int cmdSetDataBits(int argc, char **argv) {
+    // Parse the number of data bits from the command
+    int data_bits = simple_atoi(argv[1]);
+    if (data_bits < 5 || data_bits > 8) {
+        printf("Invalid data bits. Must be between 5 and 8.\n");
+        return CMD_ERR_INVALID;
+    }
+
+    // Turn off UART0 before changing data bits
+    UART0_CR = 0x0;
+
+    // Read current LCRH, clear the data bits field, and set new data bits
+    unsigned int lcrh = UART0_LCRH & ~UART0_LCRH_WLEN_MASK;
+    lcrh |= set_data_bits(data_bits); // Set the new data bits
+
+    // Write the updated value back to the LCRH register
+    UART0_LCRH = lcrh;
+
+    // Re-enable UART0 after configuration
+    UART0_CR = 0x301;UART0_LCRH = lcrh;
+
+    // Print confirmation message
+    printf("Data bits set to %d\n", data_bits);
+    return CMD_OK;
+}
+REGISTER_COMMAND_COMPLETE("setdatabits", cmdSetDataBits, completeDataBits, 1, 1, "<5|6|7|8>",
+                 "Set the UART data bits.",
+                 "Sets the UART data bits (5, 6, 7 or 8). Example: setdatabits 8");
+
+static const char *const *completeStopBits(int arg, char **argv) {
+    static const char *const values[] = {"1", "2", NULL};
+    return arg == 1 ? values : NULL;
+}
+
+static int cmdSetStopBits(int argc, char **argv) {
+    // Parse the number of stop bits from the command
+    int stop_bits = simple_atoi(argv[1]);
+    if (stop_bits != 1 && stop_bits != 2) {
+        printf("Invalid stop bits. Must be 1 or 2.\n");
+        return CMD_ERR_INVALID;
+    }
+
+    // Turn off UART0 before changing stop bits
+    UART0_CR = 0x0;
+
+    // Read current LCRH, clear the stop bits field, and set new stop bits
+    unsigned int lcrh = UART0_LCRH & ~UART0_LCRH_STP2; // Clear the stop bits
+    lcrh |= set_stop_bits(stop_bits); // Set the new stop bits
+
+    // Write the updated value back to the LCRH register
+    UART0_LCRH = lcrh;
+
+    // Re-enable UART0 after configuration
+    UART0_CR = 0x301; UART0_LCRH = lcrh;
+
+    // Print confirmation message
+    printf("Stop bits set to %d\n", stop_bits);
+    return CMD_OK;
+}
+REGISTER_COMMAND_COMPLETE("setstopbits", cmdSetStopBits, completeStopBits, 1, 1, "<1|2>",
+                 "Set the UART stop bits.",
+                 "Sets the UART stop bits (1 or 2). Example: setstopbits 1");
+
+static const char *const *completeParity(int arg, char **argv) {
+    static const char *const values[] = {"N", "E", "O", NULL};
+    return arg == 1 ? values : NULL;
+}
+
+static int cmdSetParity(int argc, char **argv) {
+    // Parse the parity setting from the command
+    char parity = argv[1][0];
+    if ((parity != 'N' && parity != 'E' && parity != 'O') || argv[1][1] != '\0') {
+        printf("Invalid parity. Must be N, E or O.\n");
+        return CMD_ERR_INVALID;
+    }
+
+    // Turn off UART0 before changing parity
+    UART0_CR = 0x0;
+
+    // Read current LCRH, clear the parity bits, then set new parity
+    unsigned int lcrh = UART0_LCRH & ~(UART0_LCRH_EPS | UART0_LCRH_PEN); // Clear parity bits
+    lcrh |= set_parity(parity); // Apply new parity settings
+
+    // Write the updated value back to the LCRH register
+    UART0_LCRH = lcrh;
+
+    // Re-enable UART0 after configuration
+    UART0_CR = 0x301; UART0_LCRH = lcrh;
+
+    // Print confirmation message based on the parity setting
+    printf("Parity set to %c\n", parity);
+    return CMD_OK;
+}
+REGISTER_COMMAND_COMPLETE("setparity", cmdSetParity, completeParity, 1, 1, "<N|E|O>",
+                 "Set the UART parity.",
+                 "Sets the UART parity (N for None, E for Even, O for Odd). Example: setparity N");
+
+static const char *const *completeFlowControl(int arg, char **argv) {
+    static const char *const values[] = {"N", "E", NULL};
+    return arg == 1 ? values : NULL;
+}
+
+static int cmdSetFlowControl(int argc, char **argv) {
+    // Parse the flow control setting from the command
+    char flow_control = argv[1][0];
+    if ((flow_control != 'N' && flow_control != 'E') || argv[1][1] != '\0') {
+        printf("Invalid flow control. Must be N or E.\n");
+        return CMD_ERR_INVALID;
+    }
+
+    // Turn off UART0 before changing flow control
+    UART0_CR = 0x0;
+
+    // Clear the RTS/CTS bits, then set new flow control
+    UART0_CR &= ~(UART0_CR_RTSEN | UART0_CR_CTSEN); // Clear flow control bits
+    UART0_CR |= set_rts_cts(flow_control); // Apply new flow control settings
+
+    // Re-enable UART0 after configuration
+    UART0_CR |= 0x301; // Reapply the enable bits
+
+    // Print confirmation message based on the flow control setting
+    printf("Flow control set to %c\n", flow_control);
+    return CMD_OK;
+}
+REGISTER_COMMAND_COMPLETE("setflowcontrol", cmdSetFlowControl, completeFlowControl, 1, 1, "<N|E>",
+                 "Set the UART hardware handshake.",
+                 "Sets the UART hardware handshake (N for None, E for Enable). Example: setflowcontrol N");
+
+static int cmdCurrentUartSettings(int argc, char **argv) {
+    unsigned int ibrd = UART0_IBRD;
+    unsigned int fbrd = UART0_FBRD;
+    unsigned int baud_rate = UART_CLOCK / (16 * (ibrd + (fbrd / 64.0)));
+    int fifo = (UART0_LCRH & UART0_LCRH_FEN) != 0;
+    int stop_bits = (UART0_LCRH & UART0_LCRH_STP2) ? 2 : 1;
+    int flow_control = (UART0_CR & UART0_CR_RTSEN) != 0;
+
+    int data_bits = 0;
+    switch (UART0_LCRH & 0x60) {
+        case UART0_LCRH_WLEN_5BIT: data_bits = 5; break;
+        case UART0_LCRH_WLEN_6BIT: data_bits = 6; break;
+        case UART0_LCRH_WLEN_7BIT: data_bits = 7; break;
+        case UART0_LCRH_WLEN_8BIT: data_bits = 8; break;
+    }
+
+    const char *parity = "None";
+    if (UART0_LCRH & UART0_LCRH_PEN) {
+        parity = (UART0_LCRH & UART0_LCRH_EPS) ? "Even" : "Odd";
+    }
+
+    // Machine mode: key=value records, values in the form the set commands take
+    if (machine_mode()) {
+        printf("baud=%d\nfifo=%d\ndatabits=%d\nparity=%c\nstopbits=%d\nflowcontrol=%c\n",
+               baud_rate, fifo, data_bits, parity[0], stop_bits, flow_control ? 'E' : 'N');
+        return CMD_OK;
+    }
+
+    printf("\nCurrent UART Settings:\n");
+    printf("Baud rate: %d\n", baud_rate);
+    printf("FIFO: %s\n", fifo ? "Enabled" : "Disabled");
+    if (data_bits) {
+        printf("Data bits: %d\n", data_bits);
+    } else {
+        printf("Data bits: Unknown\n");
+    }
+    printf("Parity: %s\n", parity);
+    printf("Stop bits: %d\n", stop_bits);
+    printf("RTS/CTS flow control: %s\n", flow_control ? "Enabled" : "Disabled");
+    return CMD_OK;
+}
+REGISTER_COMMAND("currentuartsettings", cmdCurrentUartSettings, 0, 0, "",
+                 "Display current UART settings.",
+                 "Displays the current UART settings.");
+
+static const char *const *completeBaudSwitch(int arg, char **argv) {
+    static const char *const values[] = {
+        "115200", "230400", "460800", "921600", "1000000", "1500000", "2000000", "3000000", "end", NULL
+    };
+    return arg == 1 ? values : NULL;
+}
+
+static int cmdBaudSwitch(int argc, char **argv) {
+    // Switch to a negotiated bulk-transfer rate, or back to the console rate
+    if (strcmp(argv[1], "end") == 0) {
+        uart_burst_end();
+        return CMD_OK;
+    }
+    return uart_negotiate_baud_rate(simple_atoi(argv[1])) ? CMD_OK : CMD_ERR_FAILED;
+}
+REGISTER_COMMAND_COMPLETE("baudswitch", cmdBaudSwitch, completeBaudSwitch, 1, 1, "<rate> | end",
+                 "Negotiate a bulk-transfer baud rate.",
+                 "Negotiates a high baud rate with the host for a bulk transfer. Example: baudswitch 921600, then baudswitch end");
+
+// Subcommand keyword shared by crc and sha256
+static const char *const *completeBench(int arg, char **argv) {
+    static const char *const values[] = {"bench", NULL};
+    return arg == 1 ? values : NULL;
+}
+
+// Measure CRC-32 and CRC-32C throughput over buffers of increasing size
+static int crcBenchmark() {
+    static const unsigned int sizes[] = {64, 4096, 65536, 1048576};
+    const unsigned char *buffer = bench_source;
+    uint64_t freq = timer_frequency();
+    volatile uint32_t result = 0;
+
+    printf("\n  Size (bytes)   CRC32 (GB/s)   CRC32C (GB/s)\n");
+    for (int i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        double rate[2];
+
+        // Repeat each checksum for at least 100 ms
+        for (int castagnoli = 0; castagnoli < 2; castagnoli++) {
+            unsigned int iterations = 0;
+            uint64_t start = timer_ticks(), elapsed;
+            do {
+                result = castagnoli ? crc32c(result, buffer, sizes[i]) : crc32(result, buffer, sizes[i]);
+                iterations++;
+                elapsed = timer_ticks() - start;
+            } while (elapsed < freq / 10);
+            if (job_poll()) {
+                return CMD_ERR_CANCELLED;
             }
+            rate[castagnoli] = (double)sizes[i] * iterations * freq / elapsed / 1e9;
+        }
+
+        printf("  %12d   %12.3f   %13.3f\n", sizes[i], rate[0], rate[1]);
+    }
+    return CMD_OK;
+}
+
+static int cmdCrc(int argc, char **argv) {
+    // Checksum a memory range, or benchmark the checksum module
+    if (argc == 2 && strcmp(argv[1], "bench") == 0) {
+        return crcBenchmark();
+    }
+    if (argc != 3) {
+        printf("\nUsage: crc <address> <length> | crc bench\n");
+        return CMD_ERR_USAGE;
+    }
+
+    unsigned long addr, len;
+    if (!parse_number(argv[1], &addr) || !parse_number(argv[2], &len)) {
+        printf("\nUsage: crc <address> <length> | crc bench\n");
+        return CMD_ERR_USAGE;
+    }
+    printf("\nCRC32: %08x  CRC32C: %08x\n", crc32(0, (const void *)addr, len), crc32c(0, (const void *)addr, len));
+    return CMD_OK;
+}
+REGISTER_COMMAND_COMPLETE("crc", cmdCrc, completeBench, 1, 2, "<address> <length> | bench",
+                 "Checksum memory or benchmark the CRCs.",
+                 "Computes CRC-32 and CRC-32C of a memory range, or benchmarks them. Example: crc 0x80000 4096, crc bench");
+
+// Measure SHA-256 throughput and cycles per byte of each available implementation
+static int sha256Benchmark() {
+    const unsigned char *buffer = bench_source;
+    uint64_t freq = timer_frequency();
+    uint8_t digest[SHA256_DIGEST_SIZE];
+
+    printf("\n  Implementation   MB/s       Cycles/byte\n");
+    for (int hw = 0; hw <= sha256_hw_available(); hw++) {
+        unsigned int iterations = 0;
+        sha256_use_hw(hw);
+
+        // Repeat the hash for at least 100 ms
+        uint64_t start = timer_ticks(), elapsed;
+        uint64_t cycles = pmu_cycles();
+        do {
+            sha256(buffer, SHA256_BENCH_SIZE, digest);
+            iterations++;
+            elapsed = timer_ticks() - start;
+        } while (elapsed < freq / 10);
+        cycles = pmu_cycles() - cycles;
+        if (job_poll()) {
+            sha256_use_hw(1);
+            return CMD_ERR_CANCELLED;
+        }
+
+        double bytes = (double)SHA256_BENCH_SIZE * iterations;
+        printf("  %s %9.2f  %11.2f\n", hw ? "ARMv8 crypto    " : "portable        ",
+               bytes * freq / elapsed / 1e6, cycles / bytes);
+    }
+    sha256_use_hw(1);
+    return CMD_OK;
+}
+
+static int cmdSha256(int argc, char **argv) {
+    // Hash a memory range, or benchmark the SHA-256 implementations
+    if (argc == 2 && strcmp(argv[1], "bench") == 0) {
+        return sha256Benchmark();
+    }
+    if (argc != 3) {
+        printf("\nUsage: sha256 <address> <length> | sha256 bench\n");
+        return CMD_ERR_USAGE;
+    }
+
+    unsigned long addr, len;
+    if (!parse_number(argv[1], &addr) || !parse_number(argv[2], &len)) {
+        printf("\nUsage: sha256 <address> <length> | sha256 bench\n");
+        return CMD_ERR_USAGE;
+    }
+
+    uint8_t digest[SHA256_DIGEST_SIZE];
+    sha256((const void *)addr, len, digest);
+    printf("\nSHA-256: ");
+    for (int i = 0; i < SHA256_DIGEST_SIZE; i++) {
+        printf("%02x", digest[i]);
+    }
+    printf("\n");
+    return CMD_OK;
+}
+REGISTER_COMMAND_COMPLETE("sha256", cmdSha256, completeBench, 1, 2, "<address> <length> | bench",
+                 "Hash memory or benchmark SHA-256.",
+                 "Computes the SHA-256 digest of a memory range, or benchmarks it. Example: sha256 0x80000 4096, sha256 bench");
+
+static const char *const *completeOutput(int arg, char **argv) {
+    static const char *const values[] = {"uart", "host", "file", NULL};
+    return arg == 1 ? values : NULL;
+}
+
+static int cmdOutput(int argc, char **argv) {
+    // Select the printf output sink
+    if (strcmp(argv[1], "uart") == 0) {
+        setOutputSink(uart_puts);
+        semihost_log_close();
+        printf("\nOutput on UART0\n");
+        return CMD_OK;
+    }
+    if (!semihost_available()) {
+        printf("\nSemihosting is not available. Build with 'make SEMIHOSTING=1' and run under QEMU.\n");
+        return CMD_ERR_UNAVAILABLE;
+    }
+    if (strcmp(argv[1], "host") == 0) {
+        setOutputSink(semihost_console_puts);
+        uart_puts("\nOutput on the host console\n");
+        return CMD_OK;
+    }
+    if (strcmp(argv[1], "file") == 0 && argc == 3) {
+        if (!semihost_log_open(argv[2])) {
+            printf("\nCannot open host file %s\n", argv[2]);
+            return CMD_ERR_FAILED;
         }
-        if (j == commandCount - 1) j = -1; // wrap around the command list
-        if (j == start - 1) break; // completed a full loop
+        setOutputSink(semihost_file_puts);
+        uart_puts("\nOutput written to host file ");
+        uart_puts(argv[2]);
+        uart_puts("\n");
+        return CMD_OK;
     }
+    printf("\nUsage: output uart | output host | output file <path>\n");
+    return CMD_ERR_USAGE;
+}
+REGISTER_COMMAND_COMPLETE("output", cmdOutput, completeOutput, 1, 2, "uart | host | file <path>",
+                 "Send output to UART, host console or file.",
+                 "Sends output to the UART, the host console or a host file (semihosting). Example: output file bench.txt, output uart");
+
+static const char *const *completeMode(int arg, char **argv) {
+    static const char *const values[] = {"human", "machine", NULL};
+    return arg == 1 ? values : NULL;
+}
+
+static int cmdMode(int argc, char **argv) {
+    if (strcmp(argv[1], "machine") == 0) {
+        machine_set_mode(1);
+    } else if (strcmp(argv[1], "human") == 0) {
+        machine_set_mode(0);
+    } else {
+        printf("\nUsage: mode human | mode machine\n");
+        return CMD_ERR_USAGE;
+    }
+    return CMD_OK;
+}
+REGISTER_COMMAND_COMPLETE("mode", cmdMode, completeMode, 1, 1, "human | machine",
+                          "Switch between human and machine CLI mode.",
+                          "Machine mode turns off echo, prompt and colors and answers every command line with "
+                          "a frame: SOH 'F', status (2 hex), length (8 hex), CRC-32 (8 hex), LF, then the output. "
+                          "Example: mode machine");
+
+// Completes the wrapped command's own name and arguments after "time"/"repeat"/"perf stat"
+static const char *const *completeWrapped(int arg, char **argv) {
+    static const char *const perfActions[] = {"stat", NULL};
+    int perf = strcmp(argv[0], "perf") == 0;
+    if (perf && arg == 1) {
+        return perfActions;
+    }
+
+    int option = 1 + perf; // Where -q goes
+    int skip = 1 + (perf || strcmp(argv[0], "repeat") == 0); // Words before the wrapped command
+    if (strcmp(argv[option], "-q") == 0 && arg > option) {
+        skip++;
+    }
+    if (arg < skip) {
+        return NULL;
+    }
+    if (arg == skip) {
+        return command_names();
+    }
+    const command_t *command = command_find(argv[skip]);
+    return (command && command->complete) ? command->complete(arg - skip, argv + skip) : NULL;
+}
+
+static int cmdTime(int argc, char **argv) {
+    // time [-q] <command>: -q sends the command's printf output to the null sink
+    int quiet = strcmp(argv[1], "-q") == 0;
+    if (argc - quiet < 2) {
+        printf("\nUsage: time [-q] <command>\n");
+        return CMD_ERR_USAGE;
+    }
+
+    output_sink previous = quiet ? setOutputSink(nullSink) : getOutputSink();
+    uint64_t ticks = timer_ticks();
+    uint64_t cycles = pmu_cycles();
+    int status = runCommand(argc - 1 - quiet, argv + 1 + quiet);
+    cycles = pmu_cycles() - cycles;
+    ticks = timer_ticks() - ticks;
+    setOutputSink(previous);
 
-    // If multiple matches, display all and complete the first found
-    if (multipleMatches) {
-        printf("\nPossible commands:\n");
-        for (int j = 0; j < commandCount; j++) {
-            if (strstr(commands[j], word) == commands[j]) {
-                printf("- %s\n", commands[j]);
+    printf("\nreal %lu us  cycles %lu  status %d\n", timer_ticks_to_usec(ticks), cycles, status);
+    return status;
+}
+REGISTER_COMMAND_COMPLETE("time", cmdTime, completeWrapped, 1, CMD_MAX_ARGS - 1, "[-q] <command>",
+                          "Time a command in us and CPU cycles.",
+                          "Runs a command and reports its wall time (generic timer) and CPU cycles (PMU). "
+                          "-q discards the command's output so UART time is not counted. Example: time -q showinfo");
+
+// Print one "value  name  # note" line of a perf stat report
+static void printPerfRow(uint64_t value, const char *name, int counted) {
+    if (counted) {
+        printf("%16lu  %-*.*s", value, PERF_NAME_WIDTH, PERF_NAME_WIDTH, name);
+    } else {
+        printf("%16s  %-*.*s", "<not counted>", PERF_NAME_WIDTH, PERF_NAME_WIDTH, name);
+    }
+}
+
+static int cmdPerf(int argc, char **argv) {
+    // perf stat [-q] <command>
+    int quiet = argc > 2 && strcmp(argv[2], "-q") == 0;
+    if (strcmp(argv[1], "stat") != 0 || argc - quiet < 3) {
+        printf("\nUsage: perf stat [-q] <command>\n");
+        return CMD_ERR_USAGE;
+    }
+    char **command = argv + 2 + quiet;
+    int commandArgc = argc - 2 - quiet;
+
+    pmu_snapshot start, end, delta;
+    output_sink previous = quiet ? setOutputSink(nullSink) : getOutputSink();
+    uint64_t ticks = timer_ticks();
+    pmu_read(&start);
+    int status = runCommand(commandArgc, command);
+    pmu_read(&end);
+    ticks = timer_ticks() - ticks;
+    setOutputSink(previous);
+    pmu_diff(&start, &end, &delta);
+
+    int counters = pmu_event_counters();
+    if (machine_mode()) {
+        printf("cycles=%lu\n", delta.cycles);
+        for (int i = 0; i < counters; i++) {
+            printf("%s=%lu\n", pmu_events[i].key, delta.events[i]);
+        }
+        printf("elapsed_us=%lu\n", timer_ticks_to_usec(ticks));
+        return status;
+    }
+
+    printf("\nPerformance counters for '");
+    for (int i = 0; i < commandArgc; i++) {
+        printf(i ? " %s" : "%s", command[i]);
+    }
+    printf("' (status %d):\n\n", status);
+
+    uint64_t instructions = delta.events[PMU_INSTRUCTIONS];
+    printPerfRow(delta.cycles, "cycles", 1);
+    printf("\n");
+    for (int i = 0; i < PMU_EVENT_COUNTERS; i++) {
+        uint64_t value = delta.events[i];
+        printPerfRow(value, pmu_events[i].name, i < counters);
+        if (i >= counters) {
+            printf("\n");
+        } else if (i == PMU_INSTRUCTIONS && delta.cycles) {
+            printf("#  %.2f IPC\n", (double)value / delta.cycles);
+        } else if (i == PMU_L1D_REFILLS && delta.events[PMU_L1D_ACCESSES]) {
+            printf("#  %.2f%% of L1D accesses\n", 100.0 * value / delta.events[PMU_L1D_ACCESSES]);
+        } else if ((i == PMU_L2D_REFILLS || i == PMU_BR_MISPRED) && instructions) {
+            printf("#  %.2f per 1k instructions\n", 1000.0 * value / instructions);
+        } else {
+            printf("\n");
+        }
+    }
+    printf("\n%16lu  us elapsed\n", timer_ticks_to_usec(ticks));
+    return status;
+}
+REGISTER_COMMAND_COMPLETE("perf", cmdPerf, completeWrapped, 2, CMD_MAX_ARGS - 1, "stat [-q] <command>",
+                          "Count cycles, IPC and cache misses.",
+                          "perf stat runs a command and reports its cycles, instructions per cycle, L1D and L2 "
+                          "refills, branch mispredicts and exceptions from the PMU. Only the command's own work is "
+                          "counted, not background jobs. -q discards the command's output. "
+                          "Example: perf stat -q crc bench");
+
+// Sort samples in place (insertion sort; at most REPEAT_MAX_RUNS entries)
+static void sortSamples(uint64_t *samples, int count) {
+    for (int i = 1; i < count; i++) {
+        uint64_t value = samples[i];
+        int j = i;
+        while (j > 0 && samples[j - 1] > value) {
+            samples[j] = samples[j - 1];
+            j--;
+        }
+        samples[j] = value;
+    }
+}
+
+// Print min, median, 99th percentile (nearest rank) and max of sorted samples
+static void printSampleRow(const char *label, const uint64_t *samples, int count) {
+    int p99 = (count * 99 + 99) / 100 - 1;
+    printf("%s %12lu %12lu %12lu %12lu\n", label, samples[0], samples[count / 2], samples[p99], samples[count - 1]);
+}
+
+// Samples of each running repeat, kept off the stack (16 KB each); nested
+// repeats and repeats in jobs take a slot each
+static struct {
+    int used;
+    uint64_t ticks[REPEAT_MAX_RUNS];
+    uint64_t cycles[REPEAT_MAX_RUNS];
+} repeatSlots[REPEAT_SLOTS];
+
+// Run repeat with the sample arrays of one slot
+static int runRepeat(int argc, char **argv, uint64_t *ticks, uint64_t *cycles) {
+    // repeat [-q] N <command>
+    int quiet = strcmp(argv[1], "-q") == 0;
+    if (argc - quiet < 3) {
+        printf("\nUsage: repeat [-q] <count> <command>\n");
+        return CMD_ERR_USAGE;
+    }
+    int runs = simple_atoi(argv[1 + quiet]);
+    if (runs < 1 || runs > REPEAT_MAX_RUNS) {
+        printf("\nCount must be between 1 and %d\n", REPEAT_MAX_RUNS);
+        return CMD_ERR_INVALID;
+    }
+
+    // Stop at the first failing run
+    output_sink previous = quiet ? setOutputSink(nullSink) : getOutputSink();
+    int status = CMD_OK;
+    int done;
+    for (done = 0; done < runs && status == CMD_OK; done++) {
+        if (job_poll()) {
+            status = CMD_ERR_CANCELLED;
+            break;
+        }
+        uint64_t start = timer_ticks();
+        uint64_t startCycles = pmu_cycles();
+        status = runCommand(argc - 2 - quiet, argv + 2 + quiet);
+        cycles[done] = pmu_cycles() - startCycles;
+        ticks[done] = timer_ticks() - start;
+    }
+    setOutputSink(previous);
+
+    for (int i = 0; i < done; i++) {
+        ticks[i] = timer_ticks_to_usec(ticks[i]);
+    }
+    sortSamples(ticks, done);
+    sortSamples(cycles, done);
+
+    printf("\n%d runs%s\n", done, status == CMD_OK ? "" : " (stopped on error)");
+    if (done == 0) {
+        return status;
+    }
+    printf("                min       median          p99          max\n");
+    printSampleRow("us    ", ticks, done);
+    printSampleRow("cycles", cycles, done);
+    return status;
+}
+
+static int cmdRepeat(int argc, char **argv) {
+    int slot = 0;
+    while (slot < REPEAT_SLOTS && repeatSlots[slot].used) {
+        slot++;
+    }
+    if (slot == REPEAT_SLOTS) {
+        printf("\nAlready %d repeats running\n", REPEAT_SLOTS);
+        return CMD_ERR_UNAVAILABLE;
+    }
+
+    repeatSlots[slot].used = 1;
+    int status = runRepeat(argc, argv, repeatSlots[slot].ticks, repeatSlots[slot].cycles);
+    repeatSlots[slot].used = 0;
+    return status;
+}
+REGISTER_COMMAND_COMPLETE("repeat", cmdRepeat, completeWrapped, 2, CMD_MAX_ARGS - 1, "[-q] <count> <command>",
+                          "Run a command N times; min/median/p99/max.",
+                          "Runs a command up to 1000 times and reports min, median, 99th percentile and max "
+                          "wall time and CPU cycles. -q discards the command's output. Example: repeat -q 100 showinfo");
+
+// Draw one frame of the top dashboard
+static void drawTop(int period, int lastBytes) {
+    uint64_t ticks = timer_ticks();
+    unsigned long seconds = ticks / timer_frequency();
+    int row;
+
+    screen_erase();
+    screen_fill(0, 0, SCREEN_COLS, ' ', SCREEN_TITLE);
+    screen_puts(0, 1, SCREEN_TITLE, "DoorOS top");
+    screen_printf(0, SCREEN_COLS - 22, SCREEN_TITLE, "up %u:%02u:%02u.%u", (unsigned)(seconds / 3600),
+                  (unsigned)(seconds / 60 % 60), (unsigned)(seconds % 60),
+                  (unsigned)(ticks % timer_frequency() * 10 / timer_frequency()));
+
+    screen_puts(2, 1, SCREEN_LABEL, "Cycles");
+    screen_printf(2, 12, SCREEN_NORMAL, "%lu", pmu_cycles());
+    screen_puts(3, 1, SCREEN_LABEL, "Refresh");
+    screen_printf(3, 12, SCREEN_NORMAL, "%d ms, last frame %d bytes", period, lastBytes);
+
+    screen_puts(5, 1, SCREEN_LABEL, "Jobs");
+    for (int id = 0; id < JOB_MAX; id++) {
+        const char *name;
+        const char *state = job_status(id, &name);
+        if (state) {
+            screen_printf(5 + id, 12, SCREEN_NORMAL, "[%d] %s", id + 1, state);
+            screen_puts(5 + id, 26, SCREEN_NORMAL, name);
+        } else {
+            screen_printf(5 + id, 12, SCREEN_NORMAL, "[%d] -", id + 1);
+        }
+    }
+
+    // Commands by total cycles, as many as fit
+    int order[CMD_MAX_COMMANDS];
+    int count = 0;
+    for (int i = 0; i < command_count() && i < CMD_MAX_COMMANDS; i++) {
+        if (command_statistics[i].count == 0) {
+            continue;
+        }
+        int j = count++;
+        while (j > 0 && command_statistics[order[j - 1]].total_cycles < command_statistics[i].total_cycles) {
+            order[j] = order[j - 1];
+            j--;
+        }
+        order[j] = i;
+    }
+    screen_fill(TOP_FIRST_COMMAND_ROW, 0, SCREEN_COLS, ' ', SCREEN_TITLE);
+    screen_puts(TOP_FIRST_COMMAND_ROW, 1, SCREEN_TITLE, "Command");
+    screen_puts(TOP_FIRST_COMMAND_ROW, 22, SCREEN_TITLE, "  Count     Total cycles      Mean cycles       Max cycles");
+    for (row = TOP_FIRST_COMMAND_ROW + 1; row < SCREEN_ROWS - 1 && row - TOP_FIRST_COMMAND_ROW - 1 < count; row++) {
+        int i = order[row - TOP_FIRST_COMMAND_ROW - 1];
+        command_stats *stats = &command_statistics[i];
+        screen_puts(row, 1, SCREEN_NORMAL, command_at(i)->name);
+        screen_printf(row, 22, SCREEN_NORMAL, "%7u %16lu %16lu %16lu", stats->count, stats->total_cycles,
+                      stats->total_cycles / stats->count, stats->max_cycles);
+    }
+
+    screen_puts(SCREEN_ROWS - 1, 1, SCREEN_LABEL, "Ctrl-C to quit");
+}
+
+static int cmdTop(int argc, char **argv) {
+    int period = argc == 2 ? simple_atoi(argv[1]) : TOP_REFRESH_MSEC;
+    int lastBytes = 0;
+
+    if (machine_mode()) {
+        printf("\ntop needs a terminal\n");
+        return CMD_ERR_UNAVAILABLE;
+    }
+    if (period < 50 || period > 10000) {
+        printf("\nRefresh period must be between 50 and 10000 ms\n");
+        return CMD_ERR_INVALID;
+    }
+
+    // Redraw everything each frame; screen_flush() only sends what changed
+    screen_open();
+    while (1) {
+        drawTop(period, lastBytes);
+        lastBytes = screen_flush();
+
+        uint64_t next = timer_ticks() + timer_usec_to_ticks((uint64_t)period * 1000);
+        while (timer_ticks() < next) {
+            if (job_poll()) {
+                screen_close();
+                return CMD_OK;
             }
         }
-        strncpy(buffer + i + 1, commands[firstMatchIndex], MAX_CMD_SIZE - (i + 2));
-        buffer[i + 1 + strlen(commands[firstMatchIndex])] = '\0';
-        *index = i + 1 + strlen(commands[firstMatchIndex]);
-        lastMatchIndex = firstMatchIndex;
-    } else if (found == 1) {
-        strncpy(buffer + i + 1, commands[firstMatchIndex], MAX_CMD_SIZE - (i + 2));
-        buffer[i + 1 + strlen(commands[firstMatchIndex])] = '\0';
-        *index = i + 1 + strlen(commands[firstMatchIndex]);
-        lastMatchIndex = firstMatchIndex;
+    }
+}
+REGISTER_COMMAND("top", cmdTop, 0, 1, "[msec]",
+                 "Live dashboard of jobs and command costs.",
+                 "Full-screen view of uptime, background jobs and the per-command cycle statistics, "
+                 "refreshed every 500 ms or the given period. Only changed characters are sent, so it "
+                 "keeps up at 115200 baud. Ctrl-C quits. Example: top 250");
+
+// Function to handle command and argument auto-completion of the text before the cursor
+// Returns 1 if candidates were listed, in which case the caller redraws the line
+int autoComplete(char *buffer, int *index) {
+    char line[MAX_CMD_SIZE];
+    char suffix[MAX_CMD_SIZE];
+    char *argv[CMD_MAX_ARGS];
+    int argc = 0;
+    char *saveptr; // For strtok_r
+    int exact;
+
+    buffer[*index] = '\0';
+
+    // Split the words before the cursor; the last one is completed unless
+    // the line ends in a space, in which case an empty word is
+    strncpy(line, buffer, MAX_CMD_SIZE - 1);
+    line[MAX_CMD_SIZE - 1] = '\0';
+    for (char *token = strtok_r(line, " \t", &saveptr); token != NULL && argc < CMD_MAX_ARGS - 1;
+         token = strtok_r(NULL, " \t", &saveptr)) {
+        argv[argc++] = token;
+    }
+    if (argc == 0 || buffer[*index - 1] == ' ') {
+        argv[argc++] = "";
+    }
+
+    // Pick the word list: command names first, then the command's own values
+    const char *const *words;
+    if (argc == 1) {
+        words = command_names();
     } else {
-        lastMatchIndex = -1;
+        const command_t *command = command_find(argv[0]);
+        words = (command && command->complete) ? command->complete(argc - 1, argv) : NULL;
+    }
+
+    const char *word = argv[argc - 1];
+    int n = complete_extend(words, word, suffix, MAX_CMD_SIZE - *index - 1, &exact);
+    if (n < 0) {
+        return 0;
     }
 
-    printf("\rDoorOS> %s", buffer);
-}
\ No newline at end of file
+    // A unique word also gets the separator for the next argument
+    if (exact && *index + n < MAX_CMD_SIZE - 2) {
+        suffix[n++] = ' ';
+        suffix[n] = '\0';
+    }
+
+    if (n > 0) {
+        strncpy(buffer + *index, suffix, MAX_CMD_SIZE - *index);
+        *index += n;
+    } else if (!exact) {
+        // Nothing in common to add: show the candidates
+        printf("\nPossible %s:\n", argc == 1 ? "commands" : "values");
+        complete_list(words, word);
+        return 1;
+    }
+    return 0;
+}
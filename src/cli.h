@@ -1,11 +1,12 @@
 #include "utility.h"
 
 // Function declarations for existing commands and utilities
-void processCommand(const char *cmd);
+int processCommand(const char *cmd);
+int runCommand(int argc, char **argv);
 void help();
 void home();
 void printCommandHelp(const char *cmd);
 void clear();
 void setColor(const char *textColor, const char *backgroundColor);
 void showInfo();
-void autoComplete(char *buffer, int *index);
\ No newline at end of file
+int autoComplete(char *buffer, int *index);
\ No newline at end of file
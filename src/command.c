@@ -0,0 +1,134 @@
+#include "command.h"
+#include "utility.h"
+#include "machine.h"
+
+#define COMMAND_TABLE_SIZE (2 * CMD_MAX_COMMANDS) // Power of two, half empty at capacity
+
+// Provided by link.ld around the ".commands" section (__commands_start is in command.h)
+extern const command_t __commands_end[];
+
+command_stats command_statistics[CMD_MAX_COMMANDS];
+
+static const command_t *command_table[COMMAND_TABLE_SIZE];
+static int command_table_ready = 0;
+static const char *command_name_list[CMD_MAX_COMMANDS + 1];
+
+/**
+ * FNV-1a hash of a command name
+ */
+static unsigned int command_hash(const char *name) {
+    unsigned int hash = 2166136261u;
+    while (*name) {
+        hash ^= (unsigned char)*name++;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+/**
+ * Insert every registered command into the hash table (linear probing)
+ */
+static void command_table_init() {
+    for (const command_t *cmd = __commands_start; cmd < __commands_end; cmd++) {
+        unsigned int slot = command_hash(cmd->name);
+        for (int probe = 0; probe < COMMAND_TABLE_SIZE; probe++, slot++) {
+            if (!command_table[slot & (COMMAND_TABLE_SIZE - 1)]) {
+                command_table[slot & (COMMAND_TABLE_SIZE - 1)] = cmd;
+                break;
+            }
+        }
+    }
+    command_table_ready = 1;
+}
+
+/**
+ * Look up a command by its exact name
+ * @return the descriptor, or NULL if there is no such command
+ */
+const command_t *command_find(const char *name) {
+    if (!command_table_ready) {
+        command_table_init();
+    }
+
+    unsigned int slot = command_hash(name);
+    for (int probe = 0; probe < COMMAND_TABLE_SIZE; probe++, slot++) {
+        const command_t *cmd = command_table[slot & (COMMAND_TABLE_SIZE - 1)];
+        if (!cmd) {
+            break;
+        }
+        if (strcmp(cmd->name, name) == 0) {
+            return cmd;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Number of registered commands
+ */
+int command_count() {
+    return __commands_end - __commands_start;
+}
+
+/**
+ * Registered command by position in the linker section
+ */
+const command_t *command_at(int index) {
+    return &__commands_start[index];
+}
+
+/**
+ * NULL-terminated list of every command name, for completion
+ */
+const char *const *command_names() {
+    if (!command_name_list[0]) {
+        for (int i = 0; i < command_count() && i < CMD_MAX_COMMANDS; i++) {
+            command_name_list[i] = command_at(i)->name;
+        }
+    }
+    return command_name_list;
+}
+
+static int cmdCmdStats(int argc, char **argv) {
+    if (argc == 2) {
+        if (strcmp(argv[1], "reset") != 0) {
+            printf("\nUsage: cmdstats [reset]\n");
+            return CMD_ERR_USAGE;
+        }
+        for (int i = 0; i < CMD_MAX_COMMANDS; i++) {
+            command_statistics[i] = (command_stats){0};
+        }
+        return CMD_OK;
+    }
+
+    if (!machine_mode()) {
+        printf("\nCommand              Count     Mean cycles      Max cycles  Histogram (4^n cycles: runs)\n");
+    }
+    for (int i = 0; i < command_count() && i < CMD_MAX_COMMANDS; i++) {
+        command_stats *stats = &command_statistics[i];
+        if (stats->count == 0) {
+            continue;
+        }
+
+        if (machine_mode()) {
+            printf("%s=count:%u,total:%lu,max:%lu,hist:", command_at(i)->name, stats->count,
+                   stats->total_cycles, stats->max_cycles);
+        } else {
+            printf("%-19.19s %7u %15lu %15lu ", command_at(i)->name, stats->count, stats->total_cycles / stats->count, stats->max_cycles);
+        }
+
+        const char *separator = " ";
+        for (int b = 0; b < CMD_STATS_BUCKETS; b++) {
+            if (stats->histogram[b]) {
+                printf(machine_mode() ? "%s%d/%u" : "%s%d:%u", separator, b, stats->histogram[b]);
+                separator = machine_mode() ? "," : " ";
+            }
+        }
+        printf("\n");
+    }
+    return CMD_OK;
+}
+REGISTER_COMMAND("cmdstats", cmdCmdStats, 0, 1, "[reset]",
+                 "Per-command run counts and cycle latency.",
+                 "Shows how often each command ran, its mean and max cycles, and a histogram where bucket n "
+                 "counts runs of 4^n to 4^(n+1) cycles. cmdstats reset clears them.");
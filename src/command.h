@@ -0,0 +1,95 @@
+// -----------------------------------command.h -------------------------------------
+#ifndef COMMAND_H
+#define COMMAND_H
+
+#include "../gcclib/stdint.h"
+
+/* Command registry.
+ * Each command is described by a command_t placed in the ".commands" linker
+ * section with REGISTER_COMMAND, next to its handler in whichever file
+ * implements it; link.ld collects them between __commands_start and
+ * __commands_end. Lookup is an exact match through an open-addressed hash
+ * table built on first use. */
+
+#define CMD_MAX_ARGS 16     // Including the command name
+#define CMD_MAX_COMMANDS 64 // Registry capacity, enforced by link.ld
+#define CMD_DESCRIPTOR_SIZE 56 // sizeof(command_t), for the check in link.ld
+#define CMD_STATS_BUCKETS 16 // Latency histogram: bucket b counts runs of 4^b to 4^(b+1) cycles
+
+/* Status codes returned by command handlers */
+#define CMD_OK              0
+#define CMD_ERR_USAGE       1 // Wrong number or form of arguments
+#define CMD_ERR_INVALID     2 // Argument value out of range
+#define CMD_ERR_UNAVAILABLE 3 // Feature not present in this build or on this board
+#define CMD_ERR_FAILED      4 // The operation itself failed
+#define CMD_ERR_UNKNOWN     5 // No such command
+#define CMD_ERR_CANCELLED   6 // Stopped by Ctrl-C or kill
+
+/* argv[0] is the command name, argv[1..argc-1] its arguments */
+typedef int (*command_handler)(int argc, char **argv);
+
+/* Candidate values for argument number arg (1-based) given the words before
+ * it, as a static NULL-terminated list, or NULL for nothing to offer */
+typedef const char *const *(*command_completer)(int arg, char **argv);
+
+typedef struct {
+    const char *name;
+    command_handler handler;
+    command_completer complete; // Argument completion for TAB, may be NULL
+    const char *usage;      // Argument schema shown on misuse, e.g. "<rate> | end"
+    const char *summary;    // One line for the help table
+    const char *help;       // Detailed text for 'help <command>'
+    unsigned char min_args; // Accepted argument count, excluding the name
+    unsigned char max_args;
+} command_t;
+
+_Static_assert(sizeof(command_t) == CMD_DESCRIPTOR_SIZE, "update CMD_DESCRIPTOR_SIZE and link.ld");
+
+#define REGISTER_COMMAND_COMPLETE(cmd_name, cmd_handler, cmd_complete, cmd_min_args, cmd_max_args, cmd_usage, cmd_summary, cmd_help) \
+    static const command_t __command_##cmd_handler                                                     \
+    __attribute__((used, section(".commands"), aligned(8))) = {                                           \
+        .name = cmd_name,                                                                                 \
+        .handler = cmd_handler,                                                                           \
+        .complete = cmd_complete,                                                                         \
+        .usage = cmd_usage,                                                                               \
+        .summary = cmd_summary,                                                                           \
+        .help = cmd_help,                                                                                 \
+        .min_args = cmd_min_args,                                                                         \
+        .max_args = cmd_max_args,                                                                         \
+    }
+
+#define REGISTER_COMMAND(cmd_name, cmd_handler, cmd_min_args, cmd_max_args, cmd_usage, cmd_summary, cmd_help) \
+    REGISTER_COMMAND_COMPLETE(cmd_name, cmd_handler, 0, cmd_min_args, cmd_max_args, cmd_usage, cmd_summary, cmd_help)
+
+/* Dispatcher statistics, one entry per descriptor in the same order as the
+ * .commands section, so a command's entry is found by pointer arithmetic */
+typedef struct {
+    uint32_t count;
+    uint32_t histogram[CMD_STATS_BUCKETS];
+    uint64_t total_cycles;
+    uint64_t max_cycles;
+} command_stats;
+
+extern const command_t __commands_start[];
+extern command_stats command_statistics[CMD_MAX_COMMANDS];
+
+/* Account one run of a command */
+static inline void command_record(const command_t *command, uint64_t cycles) {
+    command_stats *stats = &command_statistics[command - __commands_start];
+    int bucket = cycles ? (63 - __builtin_clzll(cycles)) >> 1 : 0;
+
+    stats->count++;
+    stats->total_cycles += cycles;
+    if (cycles > stats->max_cycles) {
+        stats->max_cycles = cycles;
+    }
+    stats->histogram[bucket < CMD_STATS_BUCKETS ? bucket : CMD_STATS_BUCKETS - 1]++;
+}
+
+/* Function prototypes */
+const command_t *command_find(const char *name);
+int command_count();
+const command_t *command_at(int index);
+const char *const *command_names();
+
+#endif
@@ -0,0 +1,173 @@
+#include "complete.h"
+#include "printf.h"
+#include "utility.h"
+
+// Trie node; index 0 means "none", so the first pool entry is never used
+typedef struct {
+    char c;
+    unsigned char terminal;  // A word ends here
+    unsigned short child;    // First child
+    unsigned short sibling;  // Next node with the same parent
+} trie_node;
+
+static trie_node nodes[COMPLETE_MAX_NODES];
+static int node_count = 1;
+
+// Word list -> root node cache
+static const char *const *trie_words[COMPLETE_MAX_TRIES];
+static unsigned short trie_roots[COMPLETE_MAX_TRIES];
+static int trie_count = 0;
+
+/**
+ * Child of a node holding character c, or 0
+ */
+static int trie_child(int node, char c) {
+    for (int n = nodes[node].child; n; n = nodes[n].sibling) {
+        if (nodes[n].c == c) {
+            return n;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Insert a word below root
+ * @return 0 if the node pool is exhausted
+ */
+static int trie_insert(int root, const char *word) {
+    int node = root;
+
+    for (; *word; word++) {
+        int next = trie_child(node, *word);
+        if (!next) {
+            if (node_count == COMPLETE_MAX_NODES) {
+                return 0;
+            }
+            next = node_count++;
+            nodes[next].c = *word;
+
+            // Keep siblings sorted so listings come out in alphabetical order
+            unsigned short *link = &nodes[node].child;
+            while (*link && nodes[*link].c < *word) {
+                link = &nodes[*link].sibling;
+            }
+            nodes[next].sibling = *link;
+            *link = next;
+        }
+        node = next;
+    }
+    nodes[node].terminal = 1;
+    return 1;
+}
+
+/**
+ * Root of the trie holding a word list, building it on first use
+ * @return the root node, or 0 if the pool is exhausted
+ */
+static int trie_root(const char *const *words) {
+    for (int i = 0; i < trie_count; i++) {
+        if (trie_words[i] == words) {
+            return trie_roots[i];
+        }
+    }
+    if (trie_count == COMPLETE_MAX_TRIES || node_count == COMPLETE_MAX_NODES) {
+        return 0;
+    }
+
+    int root = node_count++;
+    for (const char *const *word = words; *word; word++) {
+        if (!trie_insert(root, *word)) {
+            printf("\nCompletion table full\n");
+            break;
+        }
+    }
+
+    trie_words[trie_count] = words;
+    trie_roots[trie_count] = root;
+    trie_count++;
+    return root;
+}
+
+/**
+ * Node reached by walking prefix from the root of a word list, or 0
+ */
+static int trie_find(const char *const *words, const char *prefix) {
+    int node = words ? trie_root(words) : 0;
+
+    while (node && *prefix) {
+        node = trie_child(node, *prefix++);
+    }
+    return node;
+}
+
+/**
+ * Longest common extension of prefix over a word list
+ * @param suffix receives the characters to append (NUL-terminated)
+ * @param exact set to 1 when the extension completes a word no other word continues
+ * @return number of characters in suffix, or -1 if no word starts with prefix
+ */
+int complete_extend(const char *const *words, const char *prefix, char *suffix, int size, int *exact) {
+    int node = trie_find(words, prefix);
+    int n = 0;
+
+    *exact = 0;
+    if (!node) {
+        return -1;
+    }
+
+    // Follow the chain while the next character is shared by every candidate
+    while (!nodes[node].terminal && nodes[node].child && !nodes[nodes[node].child].sibling && n < size - 1) {
+        node = nodes[node].child;
+        suffix[n++] = nodes[node].c;
+    }
+    suffix[n] = '\0';
+
+    *exact = nodes[node].terminal && !nodes[node].child;
+    return n;
+}
+
+/**
+ * Print every word starting with prefix, one per line
+ * @return number of words printed
+ */
+int complete_list(const char *const *words, const char *prefix) {
+    int node = trie_find(words, prefix);
+    int count = 0;
+    int stack[32]; // Path below the prefix node, depth-first
+    char word[33];
+    int depth = 0;
+    int plen = strlen(prefix);
+
+    if (!node || plen >= (int)sizeof(word) - 1) {
+        return 0;
+    }
+    strncpy(word, prefix, sizeof(word));
+
+    // Iterative pre-order walk: descend to the first child, else move to the
+    // next sibling, else climb until a sibling exists
+    stack[0] = node;
+    while (depth >= 0) {
+        int current = stack[depth];
+        if (depth > 0) {
+            word[plen + depth - 1] = nodes[current].c;
+        }
+        if (nodes[current].terminal) {
+            word[plen + depth] = '\0';
+            printf("- %s\n", word);
+            count++;
+        }
+
+        if (nodes[current].child && depth < 31 && plen + depth < (int)sizeof(word) - 1) {
+            stack[++depth] = nodes[current].child;
+            continue;
+        }
+        while (depth > 0 && !nodes[stack[depth]].sibling) {
+            depth--;
+        }
+        if (depth == 0) {
+            break;
+        }
+        stack[depth] = nodes[stack[depth]].sibling;
+    }
+    return count;
+}
@@ -0,0 +1,19 @@
+// -----------------------------------complete.h -------------------------------------
+#ifndef COMPLETE_H
+#define COMPLETE_H
+
+/* Prefix-trie completion.
+ * Each NULL-terminated word list (command names, color names, baud rates...)
+ * is turned into a trie the first time it is completed against and cached by
+ * its address, so word lists must be static. Completing a prefix walks one
+ * node per character and then follows single-child chains, which yields the
+ * longest common prefix of every candidate. */
+
+#define COMPLETE_MAX_NODES 1024 // Shared by all tries
+#define COMPLETE_MAX_TRIES 16   // Distinct word lists
+
+/* Function prototypes */
+int complete_extend(const char *const *words, const char *prefix, char *suffix, int size, int *exact);
+int complete_list(const char *const *words, const char *prefix);
+
+#endif
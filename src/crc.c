@@ -0,0 +1,192 @@
+#include "crc.h"
+#include "../gcclib/stdint.h"
+
+#if defined(__ARM_FEATURE_CRC32)
+#include "../gcclib/arm_acle.h"
+#endif
+
+// Reflected generator polynomials
+#define CRC32_POLY  0xEDB88320 // CRC-32,  0x04C11DB7
+#define CRC32C_POLY 0x82F63B78 // CRC-32C, 0x1EDC6F41
+
+#if defined(__ARM_FEATURE_CRC32)
+
+/* Large buffers are split into three blocks of CRC_BLOCK bytes whose CRCs are
+ * computed in the same loop. The crc32 instructions have a latency of 3 cycles
+ * but a throughput of one per cycle, so three independent chains keep the unit
+ * busy. The partial results are then joined by advancing the earlier register
+ * over CRC_BLOCK zero bytes (a multiplication by x^(8*CRC_BLOCK) mod P), which is
+ * done with four table lookups. */
+#define CRC_BLOCK 1024
+
+typedef uint64_t __attribute__((may_alias)) crc_word_t;
+
+static uint32_t crc32_shift[4][256];
+static uint32_t crc32c_shift[4][256];
+static int shift_tables_ready = 0;
+
+/**
+ * Multiply a(x) by b(x) modulo the polynomial, in the reflected bit order
+ * where bit 31 holds the x^0 coefficient
+ */
+static uint32_t multmodp(uint32_t a, uint32_t b, uint32_t poly) {
+    uint32_t m = (uint32_t)1 << 31;
+    uint32_t product = 0;
+
+    while (m) {
+        if (a & m) {
+            product ^= b;
+        }
+        m >>= 1;
+        b = (b & 1) ? (b >> 1) ^ poly : b >> 1;
+    }
+    return product;
+}
+
+/**
+ * Compute x^(8 * n) modulo the polynomial by square-and-multiply
+ */
+static uint32_t xpow8n(size_t n, uint32_t poly) {
+    uint32_t result = (uint32_t)1 << 31; // x^0
+    uint32_t base = (uint32_t)1 << 23;   // x^8
+
+    while (n) {
+        if (n & 1) {
+            result = multmodp(base, result, poly);
+        }
+        base = multmodp(base, base, poly);
+        n >>= 1;
+    }
+    return result;
+}
+
+/**
+ * Build the byte-sliced tables for multiplying a CRC register by x^(8*CRC_BLOCK)
+ */
+static void build_shift_table(uint32_t table[4][256], uint32_t poly) {
+    uint32_t k = xpow8n(CRC_BLOCK, poly);
+
+    for (int j = 0; j < 4; j++) {
+        for (uint32_t i = 0; i < 256; i++) {
+            table[j][i] = multmodp(i << (8 * j), k, poly);
+        }
+    }
+}
+
+static inline uint32_t crc_shift(const uint32_t table[4][256], uint32_t r) {
+    return table[0][r & 0xFF] ^ table[1][(r >> 8) & 0xFF] ^
+           table[2][(r >> 16) & 0xFF] ^ table[3][r >> 24];
+}
+
+static inline uint32_t crc_byte(uint32_t r, uint8_t b, int castagnoli) {
+    return castagnoli ? __crc32cb(r, b) : __crc32b(r, b);
+}
+
+static inline uint32_t crc_dword(uint32_t r, uint64_t d, int castagnoli) {
+    return castagnoli ? __crc32cd(r, d) : __crc32d(r, d);
+}
+
+/**
+ * Update a CRC using the CRC32 instructions. Inlined with a constant
+ * castagnoli argument, so each public function gets its own loop.
+ */
+static inline __attribute__((always_inline))
+uint32_t crc_update(uint32_t crc, const void *data, size_t len, int castagnoli) {
+    const uint8_t *p = data;
+    uint32_t r = ~crc; // The instructions work on the raw, unconditioned register
+
+    // Single bytes until the pointer is 8-byte aligned
+    while (len && ((uintptr_t)p & 7)) {
+        r = crc_byte(r, *p++, castagnoli);
+        len--;
+    }
+
+    if (len >= 3 * CRC_BLOCK && !shift_tables_ready) {
+        build_shift_table(crc32_shift, CRC32_POLY);
+        build_shift_table(crc32c_shift, CRC32C_POLY);
+        shift_tables_ready = 1;
+    }
+
+    // Three interleaved streams over consecutive blocks
+    while (len >= 3 * CRC_BLOCK) {
+        const crc_word_t *a = (const crc_word_t *)p;
+        const crc_word_t *b = a + CRC_BLOCK / 8;
+        const crc_word_t *c = b + CRC_BLOCK / 8;
+        uint32_t rb = 0, rc = 0;
+
+        for (int i = 0; i < CRC_BLOCK / 8; i++) {
+            r = crc_dword(r, a[i], castagnoli);
+            rb = crc_dword(rb, b[i], castagnoli);
+            rc = crc_dword(rc, c[i], castagnoli);
+        }
+
+        const uint32_t (*table)[256] = castagnoli ? crc32c_shift : crc32_shift;
+        r = crc_shift(table, r) ^ rb;
+        r = crc_shift(table, r) ^ rc;
+
+        p += 3 * CRC_BLOCK;
+        len -= 3 * CRC_BLOCK;
+    }
+
+    // Remaining whole words, then bytes
+    while (len >= 8) {
+        r = crc_dword(r, *(const crc_word_t *)p, castagnoli);
+        p += 8;
+        len -= 8;
+    }
+    while (len--) {
+        r = crc_byte(r, *p++, castagnoli);
+    }
+
+    return ~r;
+}
+
+#else // Table-driven fallback
+
+static uint32_t crc32_table[256];
+static uint32_t crc32c_table[256];
+static int tables_ready = 0;
+
+static void build_table(uint32_t table[256], uint32_t poly) {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t r = i;
+        for (int bit = 0; bit < 8; bit++) {
+            r = (r >> 1) ^ (poly & -(r & 1));
+        }
+        table[i] = r;
+    }
+}
+
+static uint32_t crc_update(uint32_t crc, const void *data, size_t len, int castagnoli) {
+    const uint8_t *p = data;
+    uint32_t r = ~crc;
+
+    if (!tables_ready) {
+        build_table(crc32_table, CRC32_POLY);
+        build_table(crc32c_table, CRC32C_POLY);
+        tables_ready = 1;
+    }
+
+    const uint32_t *table = castagnoli ? crc32c_table : crc32_table;
+    while (len--) {
+        r = table[(r ^ *p++) & 0xFF] ^ (r >> 8);
+    }
+
+    return ~r;
+}
+
+#endif
+
+/**
+ * CRC-32 (IEEE), compatible with zlib's crc32()
+ */
+uint32_t crc32(uint32_t crc, const void *data, size_t len) {
+    return crc_update(crc, data, len, 0);
+}
+
+/**
+ * CRC-32C (Castagnoli), as used by iSCSI, ext4 and SCTP
+ */
+uint32_t crc32c(uint32_t crc, const void *data, size_t len) {
+    return crc_update(crc, data, len, 1);
+}
@@ -0,0 +1,20 @@
+// -----------------------------------crc.h -------------------------------------
+#ifndef CRC_H
+#define CRC_H
+
+#include "../gcclib/stddef.h"
+#include "gpio.h"
+
+/* CRC-32 (IEEE 802.3, as used by zlib/Ethernet) and CRC-32C (Castagnoli).
+ * Both are zlib-compatible running checksums: start with crc = 0 and pass the
+ * previous result to continue over more data.
+ *
+ * On ARMv8 with the CRC32 extension (-march=armv8-a+crc) the CRC32 instructions
+ * are used through arm_acle.h, running three independent streams over large
+ * buffers to hide the instruction latency. Other builds (e.g. host tools) fall
+ * back to a byte-wise table. */
+
+uint32_t crc32(uint32_t crc, const void *data, size_t len);
+uint32_t crc32c(uint32_t crc, const void *data, size_t len);
+
+#endif
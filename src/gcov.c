@@ -0,0 +1,346 @@
+#include "gcov.h"
+#include "../gcclib/gcov.h"
+#include "command.h"
+#include "machine.h"
+#include "semihost.h"
+#include "crc.h"
+#include "utility.h"
+
+#ifdef GCOV
+
+static gcov_info *gcov_objects = NULL; // Newest first
+static int gcov_count = 0;
+
+// Serialized .gcda of one object; dumps in chunks read a snapshot taken at offset 0
+static uint8_t gcov_buffer[GCOV_BUFFER_SIZE];
+static int gcov_snapshot = -1; // Object in gcov_buffer
+static unsigned int gcov_snapshot_size = 0;
+
+/**
+ * Register an object's counters; called from its constructor
+ */
+void __gcov_init(gcov_info *info) {
+    info->next = gcov_objects;
+    gcov_objects = info;
+    gcov_count++;
+}
+
+/**
+ * Merge function of the arc counters. libgcov calls it to add the counts
+ * already in a .gcda file; here runs are merged on the host, if at all.
+ */
+void __gcov_merge_add(gcov_type *counters, unsigned int n) {
+}
+
+/**
+ * Called by GCC's destructors at exit, which the kernel never reaches
+ */
+void __gcov_exit(void) {
+}
+
+/**
+ * Zero every counter
+ */
+void __gcov_reset(void) {
+    for (gcov_info *info = gcov_objects; info; info = info->next) {
+        for (unsigned int f = 0; f < info->n_functions; f++) {
+            const gcov_fn_info *function = info->functions[f];
+            if (!function || function->key != info) {
+                continue;
+            }
+            const gcov_ctr_info *counter = function->ctrs;
+            for (int type = 0; type < GCOV_COUNTERS; type++) {
+                if (!info->merge[type]) {
+                    continue;
+                }
+                for (unsigned int i = 0; i < counter->num; i++) {
+                    counter->values[i] = 0;
+                }
+                counter++;
+            }
+        }
+    }
+}
+
+/**
+ * Object number index (0 = first registered), or NULL
+ */
+static gcov_info *gcov_object(int index) {
+    gcov_info *info = gcov_objects;
+    for (int i = gcov_count - 1; info && i > index; i--) {
+        info = info->next;
+    }
+    return index >= 0 && index < gcov_count ? info : NULL;
+}
+
+/**
+ * Largest arc count of the whole run, for the object summary
+ */
+static uint64_t gcov_sum_max() {
+    uint64_t max = 0;
+    for (gcov_info *info = gcov_objects; info; info = info->next) {
+        if (!info->merge[GCOV_COUNTER_ARCS]) {
+            continue;
+        }
+        for (unsigned int f = 0; f < info->n_functions; f++) {
+            const gcov_fn_info *function = info->functions[f];
+            if (!function || function->key != info) {
+                continue;
+            }
+            // Arc counters come first when present
+            for (unsigned int i = 0; i < function->ctrs[0].num; i++) {
+                if ((uint64_t)function->ctrs[0].values[i] > max) {
+                    max = function->ctrs[0].values[i];
+                }
+            }
+        }
+    }
+    return max;
+}
+
+/**
+ * Append a 32-bit word in the target's (little endian) byte order; only
+ * counts the bytes when buffer is NULL
+ */
+static unsigned int gcov_store(uint8_t *buffer, unsigned int position, uint32_t value) {
+    if (buffer) {
+        for (int i = 0; i < 4; i++) {
+            buffer[position + i] = value >> (8 * i);
+        }
+    }
+    return position + 4;
+}
+
+/**
+ * Serialize one object in the .gcda format, as libgcov's write_one_data()
+ * @param buffer at least gcov_serialize(info, NULL, ...) bytes, or NULL to measure
+ * @return bytes written
+ */
+static unsigned int gcov_serialize(const gcov_info *info, uint8_t *buffer, uint64_t sum_max) {
+    unsigned int position = 0;
+
+    position = gcov_store(buffer, position, GCOV_DATA_MAGIC);
+    position = gcov_store(buffer, position, info->version);
+    position = gcov_store(buffer, position, info->stamp);
+#if __GNUC__ >= 12
+    position = gcov_store(buffer, position, info->checksum);
+#endif
+
+    // One run; the counts are this boot's
+    position = gcov_store(buffer, position, GCOV_TAG_OBJECT_SUMMARY);
+    position = gcov_store(buffer, position, GCOV_TAG_SUMMARY_LENGTH * GCOV_UNIT_SIZE);
+    position = gcov_store(buffer, position, 1);
+    position = gcov_store(buffer, position, sum_max > 0xFFFFFFFF ? 0xFFFFFFFF : sum_max);
+
+    for (unsigned int f = 0; f < info->n_functions; f++) {
+        const gcov_fn_info *function = info->functions[f];
+
+        position = gcov_store(buffer, position, GCOV_TAG_FUNCTION);
+        if (!function || function->key != info) {
+            // Removed, or a COMDAT copy counted by another object
+            position = gcov_store(buffer, position, 0);
+            continue;
+        }
+        position = gcov_store(buffer, position, GCOV_TAG_FUNCTION_LENGTH * GCOV_UNIT_SIZE);
+        position = gcov_store(buffer, position, function->ident);
+        position = gcov_store(buffer, position, function->lineno_checksum);
+        position = gcov_store(buffer, position, function->cfg_checksum);
+
+        const gcov_ctr_info *counter = function->ctrs;
+        for (int type = 0; type < GCOV_COUNTERS; type++) {
+            if (!info->merge[type]) {
+                continue;
+            }
+            position = gcov_store(buffer, position, GCOV_TAG_FOR_COUNTER(type));
+            position = gcov_store(buffer, position, counter->num * 2 * GCOV_UNIT_SIZE);
+            for (unsigned int i = 0; i < counter->num; i++) {
+                uint64_t value = counter->values[i];
+                position = gcov_store(buffer, position, value);
+                position = gcov_store(buffer, position, value >> 32);
+            }
+            counter++;
+        }
+    }
+    return gcov_store(buffer, position, 0); // End of file
+}
+
+/**
+ * Serialize an object into gcov_buffer
+ * @return bytes, or 0 if it does not fit
+ */
+static unsigned int gcov_take_snapshot(int index) {
+    gcov_info *info = gcov_object(index);
+    uint64_t sum_max = gcov_sum_max();
+
+    gcov_snapshot = -1;
+    if (gcov_serialize(info, NULL, sum_max) > GCOV_BUFFER_SIZE) {
+        return 0;
+    }
+    gcov_snapshot_size = gcov_serialize(info, gcov_buffer, sum_max);
+    gcov_snapshot = index;
+    return gcov_snapshot_size;
+}
+
+/**
+ * Print part of the snapshot as a block for tools/gcovrecv.py:
+ *   gcda <index> <size> <offset> <path>
+ *   <hex, GCOV_LINE_BYTES per line>
+ *   end <CRC-32 of the bytes in the block>
+ */
+static void gcov_print(int index, unsigned int offset, unsigned int length) {
+    static const char digits[] = "0123456789abcdef";
+    char line[2 * GCOV_LINE_BYTES + 1];
+
+    printf("gcda %d %u %u %s\n", index, gcov_snapshot_size, offset, gcov_object(index)->filename);
+    for (unsigned int start = 0; start < length; start += GCOV_LINE_BYTES) {
+        int n = 0;
+        for (unsigned int i = start; i < length && i < start + GCOV_LINE_BYTES; i++) {
+            line[n++] = digits[gcov_buffer[offset + i] >> 4];
+            line[n++] = digits[gcov_buffer[offset + i] & 0xF];
+        }
+        line[n] = '\0';
+        printf("%s\n", line);
+    }
+    printf("end %x\n", crc32(0, gcov_buffer + offset, length));
+}
+
+/**
+ * Write every object's .gcda to its build path on the host
+ * @return objects written
+ */
+static int gcov_write() {
+    int written = 0;
+    for (int index = 0; index < gcov_count; index++) {
+        const char *path = gcov_object(index)->filename;
+        unsigned int size = gcov_take_snapshot(index);
+        int fd = size ? semihost_open(path, SEMIHOST_MODE_WRITE) : -1;
+
+        if (fd < 0 || semihost_write(fd, gcov_buffer, size) != size) {
+            printf("\nCannot write %s\n", path);
+        } else {
+            written++;
+        }
+        if (fd >= 0) {
+            semihost_close(fd);
+        }
+    }
+    return written;
+}
+
+/**
+ * Store the .gcda files on the host (semihosting builds only)
+ */
+void __gcov_dump(void) {
+    if (semihost_available()) {
+        gcov_write();
+    }
+}
+
+void __gcov_flush(void) {
+    __gcov_dump();
+    __gcov_reset();
+}
+
+static int gcovDump(int argc, char **argv) {
+    unsigned long index, offset = 0;
+
+    if (argc == 2) {
+        for (int i = 0; i < gcov_count; i++) {
+            if (!gcov_take_snapshot(i)) {
+                printf("\n%s does not fit the %d byte buffer\n", gcov_object(i)->filename, GCOV_BUFFER_SIZE);
+                return CMD_ERR_FAILED;
+            }
+            gcov_print(i, 0, gcov_snapshot_size);
+        }
+        return CMD_OK;
+    }
+
+    if (!parse_number(argv[2], &index) || (argc == 4 && !parse_number(argv[3], &offset))) {
+        printf("\nUsage: gcov dump [<object> [<offset>]]\n");
+        return CMD_ERR_USAGE;
+    }
+    if (index >= gcov_count) {
+        printf("\nNo object %lu (gcov list)\n", index);
+        return CMD_ERR_INVALID;
+    }
+    // Offset 0 takes a new snapshot, so the chunks of one file agree
+    if (offset == 0 || gcov_snapshot != index) {
+        if (!gcov_take_snapshot(index)) {
+            printf("\n%s does not fit the %d byte buffer\n", gcov_object(index)->filename, GCOV_BUFFER_SIZE);
+            return CMD_ERR_FAILED;
+        }
+    }
+    if (offset > gcov_snapshot_size) {
+        printf("\nOffset beyond the %u bytes of object %lu\n", gcov_snapshot_size, index);
+        return CMD_ERR_INVALID;
+    }
+    unsigned int length = gcov_snapshot_size - offset;
+    gcov_print(index, offset, length < GCOV_CHUNK_SIZE ? length : GCOV_CHUNK_SIZE);
+    return CMD_OK;
+}
+
+static const char *const *completeGcov(int arg, char **argv) {
+    static const char *const actions[] = {"dump", "list", "reset", "write", NULL};
+    return arg == 1 ? actions : NULL;
+}
+
+static int cmdGcov(int argc, char **argv) {
+    if (strcmp(argv[1], "list") == 0 && argc == 2) {
+        uint64_t sum_max = gcov_sum_max();
+        if (!machine_mode()) {
+            printf("\n  #    Bytes  Functions  File\n");
+        }
+        for (int i = 0; i < gcov_count; i++) {
+            const gcov_info *info = gcov_object(i);
+            unsigned int size = gcov_serialize(info, NULL, sum_max);
+            if (machine_mode()) {
+                printf("%d=bytes:%u,functions:%u,path:%s\n", i, size, info->n_functions, info->filename);
+            } else {
+                printf("%3d %8u %10u  %s\n", i, size, info->n_functions, info->filename);
+            }
+        }
+        return CMD_OK;
+    }
+    if (strcmp(argv[1], "dump") == 0) {
+        return gcovDump(argc, argv);
+    }
+    if (strcmp(argv[1], "reset") == 0 && argc == 2) {
+        __gcov_reset();
+        return CMD_OK;
+    }
+    if (strcmp(argv[1], "write") == 0 && argc == 2) {
+        if (!semihost_available()) {
+            printf("\nSemihosting is not available. Build with 'make pgo-gen SEMIHOSTING=1' and run under QEMU.\n");
+            return CMD_ERR_UNAVAILABLE;
+        }
+        int written = gcov_write();
+        if (!machine_mode()) {
+            printf("\nWrote %d of %d .gcda files\n", written, gcov_count);
+        }
+        return written == gcov_count ? CMD_OK : CMD_ERR_FAILED;
+    }
+    printf("\nUsage: gcov list | dump [<object> [<offset>]] | reset | write\n");
+    return CMD_ERR_USAGE;
+}
+
+#else
+
+static const char *const *completeGcov(int arg, char **argv) {
+    return NULL;
+}
+
+static int cmdGcov(int argc, char **argv) {
+    printf("\nProfile counters are not compiled in. Build with 'make pgo-gen'.\n");
+    return CMD_ERR_UNAVAILABLE;
+}
+
+#endif
+
+REGISTER_COMMAND_COMPLETE("gcov", cmdGcov, completeGcov, 1, 3, "list | dump [<object> [<offset>]] | reset | write",
+                          "Profile counters for PGO builds (make pgo-gen).",
+                          "In a 'make pgo-gen' build every branch is counted per object file. gcov list shows the "
+                          "objects, gcov reset zeroes the counts, and gcov dump prints each object's .gcda data as "
+                          "hex for tools/gcovrecv.py, which writes build/*.gcda for 'make pgo-use'. With an object "
+                          "number it prints up to 4096 bytes from an offset (0 takes a fresh snapshot). Under "
+                          "QEMU with semihosting, gcov write stores the files on the host directly. "
+                          "Example: gcov dump 3 4096");
@@ -0,0 +1,86 @@
+// -----------------------------------gcov.h -------------------------------------
+#ifndef GCOV_H
+#define GCOV_H
+
+#include "gpio.h"
+
+/* Minimal gcov runtime for profile-guided builds ("make pgo-gen").
+ * With -fprofile-generate GCC gives every object file a table of arc
+ * counters and a constructor that hands it to __gcov_init(); main() runs the
+ * constructors (.init_array in link.ld). Instead of writing .gcda files at
+ * exit like libgcov, the kernel serializes them on command: 'gcov dump'
+ * prints them as hex for tools/gcovrecv.py, and 'gcov write' stores them
+ * under their build paths through semihosting. 'make pgo-use' then rebuilds
+ * kernel8.img with -fprofile-use from the .gcda files in build/.
+ *
+ * Only the arc counters are supported: value profiling (and with it the
+ * time profiler) is turned off in the Makefile, so __gcov_merge_add is the
+ * only merge function referenced. Runs are not merged on the board; each
+ * dump is one run, and gcov-tool merge can combine them on the host. The
+ * structures follow GCC's gcov-io.h and change with the compiler version. */
+
+#if defined(GCOV) && __GNUC__ < 10
+#error "The gcov runtime needs GCC 10 or later"
+#endif
+
+#if __GNUC__ >= 14
+#define GCOV_COUNTERS 9
+#else
+#define GCOV_COUNTERS 8
+#endif
+
+#if __GNUC__ >= 12
+#define GCOV_UNIT_SIZE 4 // Record lengths are in bytes
+#else
+#define GCOV_UNIT_SIZE 1 // Record lengths are in words
+#endif
+
+#define GCOV_DATA_MAGIC 0x67636461 // "gcda"
+#define GCOV_TAG_FUNCTION 0x01000000
+#define GCOV_TAG_FUNCTION_LENGTH 3
+#define GCOV_TAG_COUNTER_BASE 0x01a10000
+#define GCOV_TAG_FOR_COUNTER(counter) (GCOV_TAG_COUNTER_BASE + ((uint32_t)(counter) << 17))
+#define GCOV_TAG_OBJECT_SUMMARY 0xa1000000
+#define GCOV_TAG_SUMMARY_LENGTH 2
+#define GCOV_COUNTER_ARCS 0
+
+#define GCOV_BUFFER_SIZE (128 * 1024) // Largest .gcda that can be serialized
+#define GCOV_CHUNK_SIZE 4096          // Bytes per 'gcov dump <n> <offset>'; fits the machine mode capture
+#define GCOV_LINE_BYTES 32            // Bytes per hex line
+
+typedef long long gcov_type;
+
+typedef struct gcov_info gcov_info;
+
+typedef struct {
+    unsigned int num;  // Counters
+    gcov_type *values;
+} gcov_ctr_info;
+
+typedef struct {
+    const gcov_info *key; // The object this function belongs to; others are COMDAT copies
+    unsigned int ident;
+    unsigned int lineno_checksum;
+    unsigned int cfg_checksum;
+    gcov_ctr_info ctrs[]; // One per counter type with a merge function
+} gcov_fn_info;
+
+struct gcov_info {
+    unsigned int version;
+    gcov_info *next;
+    unsigned int stamp;
+#if __GNUC__ >= 12
+    unsigned int checksum;
+#endif
+    const char *filename; // Absolute .gcda path on the build host
+    void (*merge[GCOV_COUNTERS])(gcov_type *, unsigned int);
+    unsigned int n_functions;
+    const gcov_fn_info *const *functions;
+};
+
+/* Called by the compiler's generated code */
+void __gcov_init(gcov_info *info);
+void __gcov_merge_add(gcov_type *counters, unsigned int n);
+void __gcov_exit(void);
+
+#endif
@@ -0,0 +1,50 @@
+#include "history.h"
+#include "utility.h"
+
+static char entries[HISTORY_DEPTH][HISTORY_LINE_SIZE];
+static int head = 0;  // Slot the next line goes into
+static int count = 0; // Valid entries, at most HISTORY_DEPTH
+
+/**
+ * Record a command line; empty lines and repeats of the last line are skipped
+ */
+void history_add(const char *line) {
+    if (line[0] == '\0' || (count > 0 && strcmp(history_get(0), line) == 0)) {
+        return;
+    }
+
+    strncpy(entries[head], line, HISTORY_LINE_SIZE - 1);
+    entries[head][HISTORY_LINE_SIZE - 1] = '\0';
+    head = (head + 1) % HISTORY_DEPTH;
+    if (count < HISTORY_DEPTH) {
+        count++;
+    }
+}
+
+int history_count() {
+    return count;
+}
+
+/**
+ * Entry by age, 0 being the most recent
+ * @return the line, or NULL if there is no entry that old
+ */
+const char *history_get(int age) {
+    if (age < 0 || age >= count) {
+        return NULL;
+    }
+    return entries[(head - 1 - age + HISTORY_DEPTH) % HISTORY_DEPTH];
+}
+
+/**
+ * Find the most recent entry containing pattern, starting at the given age
+ * @return the age of the match, or -1
+ */
+int history_search(const char *pattern, int age) {
+    for (; age >= 0 && age < count; age++) {
+        if (strstr(history_get(age), pattern)) {
+            return age;
+        }
+    }
+    return -1;
+}
@@ -0,0 +1,23 @@
+// -----------------------------------history.h -------------------------------------
+#ifndef HISTORY_H
+#define HISTORY_H
+
+/* Command history.
+ * A ring of HISTORY_DEPTH lines: adding a line overwrites the oldest one
+ * once the ring is full, so no entries are ever moved. Entries are addressed
+ * by age, 0 being the most recent. Override the depth with
+ * "make HISTORY_DEPTH=n". */
+
+#ifndef HISTORY_DEPTH
+#define HISTORY_DEPTH 32
+#endif
+
+#define HISTORY_LINE_SIZE 100 // Same as the CLI's MAX_CMD_SIZE
+
+/* Function prototypes */
+void history_add(const char *line);
+int history_count();
+const char *history_get(int age);
+int history_search(const char *pattern, int age);
+
+#endif
@@ -0,0 +1,90 @@
+#include "irq.h"
+#include "printf.h"
+#include "unwind.h"
+
+static irq_handler timer_handler = NULL;
+
+/**
+ * Route the core timer interrupt to this core's IRQ line and unmask IRQs.
+ * The timer itself stays off until a handler is registered and programs it.
+ */
+void irq_init() {
+#ifdef RPI3
+    LOCAL_TIMER_INT_CTRL0 = LOCAL_CNTPNSIRQ;
+#else
+    GICD_CTLR = 0;
+    GICD_IPRIORITYR(GIC_PPI_CNTPNS) = 0xA0;
+    GICD_ISENABLER0 = 1 << GIC_PPI_CNTPNS;
+    GICD_CTLR = 1;
+    GICC_PMR = 0xF0;  // Let every priority above the lowest through
+    GICC_CTLR = 1;
+#endif
+    irq_enable();
+}
+
+/**
+ * Set the function called on every timer interrupt (NULL for none). It must
+ * re-arm or stop the timer, whose interrupt stays asserted until it does.
+ */
+void irq_set_timer_handler(irq_handler handler) {
+    timer_handler = handler;
+}
+
+/**
+ * Whether a command owns the timer interrupt (the profiler, irqlat)
+ */
+int irq_timer_busy() {
+    return timer_handler != NULL;
+}
+
+static void irq_timer(exception_frame *frame) {
+    if (timer_handler) {
+        timer_handler(frame);
+    } else {
+        asm volatile("msr cntp_ctl_el0, xzr");
+    }
+}
+
+/**
+ * IRQ entry from vectors.S
+ */
+void irq_dispatch(exception_frame *frame) {
+#ifdef RPI3
+    if (LOCAL_IRQ_SOURCE0 & LOCAL_CNTPNSIRQ) {
+        irq_timer(frame);
+    }
+#else
+    unsigned int iar = GICC_IAR;
+    unsigned int id = iar & 0x3FF;
+
+    if (id == GIC_SPURIOUS) {
+        return;
+    }
+    if (id == GIC_PPI_CNTPNS) {
+        irq_timer(frame);
+    }
+    GICC_EOIR = iar;
+#endif
+}
+
+/**
+ * Any exception other than an IRQ: report it; vectors.S then halts the core
+ */
+void exception_unhandled(exception_frame *frame, uint64_t type) {
+    static const char *const kinds[] = {"Synchronous", "IRQ", "FIQ", "SError"};
+    static const char *const origins[] = {"EL1 on SP0", "EL1", "EL0 (AArch64)", "EL0 (AArch32)"};
+    uint64_t esr, far;
+
+    asm volatile("mrs %0, esr_el1" : "=r"(esr));
+    asm volatile("mrs %0, far_el1" : "=r"(far));
+
+    setOutputSink(uart_puts);
+    printf("\n\n*** %s exception from %s\n", kinds[type & 3], origins[(type >> 2) & 3]);
+    printf("ESR %lx (class %x)  ELR %lx  FAR %lx  SPSR %lx\n", esr, (unsigned int)(esr >> 26), frame->elr, far,
+           frame->spsr);
+    printf("x29 %lx  x30 %lx\n", frame->x[29], frame->x[30]);
+
+    uint64_t pcs[UNWIND_MAX_DEPTH];
+    printf("Call stack:\n");
+    unwind_print(pcs, unwind_exception(frame, pcs, UNWIND_MAX_DEPTH));
+}
@@ -0,0 +1,73 @@
+// -----------------------------------irq.h -------------------------------------
+#ifndef IRQ_H
+#define IRQ_H
+
+#include "gpio.h"
+
+/* Interrupts at EL1.
+ * vectors.S saves the interrupted context as an exception_frame and calls
+ * irq_dispatch(), which acknowledges the interrupt controller and runs the
+ * handler registered for the source. The only source so far is the core's
+ * EL1 physical timer (CNTP), routed through the ARM local interrupt
+ * controller on RPI3 and the GIC-400 (PPI 30) on RPI4. Handlers run with
+ * interrupts masked and must be short: no printf, no job_poll(). */
+
+/* ARM local peripherals (RPI3) */
+#define LOCAL_BASE 0x40000000
+#define LOCAL_TIMER_INT_CTRL0 (*(volatile unsigned int *)(LOCAL_BASE + 0x40)) // Core 0 timer IRQ enables
+#define LOCAL_IRQ_SOURCE0     (*(volatile unsigned int *)(LOCAL_BASE + 0x60)) // Core 0 pending IRQs
+#define LOCAL_CNTPNSIRQ (1 << 1)
+
+/* GIC-400 (RPI4) */
+#define GIC_BASE 0xFF840000
+#define GICD_BASE (GIC_BASE + 0x1000)
+#define GICC_BASE (GIC_BASE + 0x2000)
+#define GICD_CTLR       (*(volatile unsigned int *)(GICD_BASE + 0x000))
+#define GICD_ISENABLER0 (*(volatile unsigned int *)(GICD_BASE + 0x100))
+#define GICD_ICENABLER0 (*(volatile unsigned int *)(GICD_BASE + 0x180))
+#define GICD_IPRIORITYR(n) (*(volatile unsigned char *)(GICD_BASE + 0x400 + (n)))
+#define GICC_CTLR (*(volatile unsigned int *)(GICC_BASE + 0x00))
+#define GICC_PMR  (*(volatile unsigned int *)(GICC_BASE + 0x04))
+#define GICC_IAR  (*(volatile unsigned int *)(GICC_BASE + 0x0C))
+#define GICC_EOIR (*(volatile unsigned int *)(GICC_BASE + 0x10))
+#define GIC_SPURIOUS 1023
+#define GIC_PPI_CNTPNS 30 // Non-secure EL1 physical timer
+
+/* Interrupted context, as saved by vectors.S (800 bytes) */
+typedef struct {
+    uint64_t x[31];    // x0-x30: x29 is the frame pointer, x30 the link register
+    uint64_t elr;      // Where the code was interrupted
+    uint64_t spsr;
+    uint64_t type;     // Vector slot (0-15), for unhandled exceptions
+    uint64_t simd[64]; // q0-q31
+    uint64_t fpsr;
+    uint64_t fpcr;
+} exception_frame;
+_Static_assert(sizeof(exception_frame) == 800, "update the FRAME_ offsets in vectors.S");
+
+typedef void (*irq_handler)(exception_frame *frame);
+
+/* Unmask / mask IRQs on this core */
+static inline void irq_enable(void) {
+    asm volatile("msr daifclr, #2" : : : "memory");
+}
+
+static inline void irq_disable(void) {
+    asm volatile("msr daifset, #2" : : : "memory");
+}
+
+/* Core number (0-3) of the running code */
+static inline int irq_core(void) {
+    uint64_t mpidr;
+    asm volatile("mrs %0, mpidr_el1" : "=r"(mpidr));
+    return mpidr & 3;
+}
+
+/* Function prototypes */
+void irq_init();
+void irq_set_timer_handler(irq_handler handler);
+int irq_timer_busy();
+void irq_dispatch(exception_frame *frame);
+void exception_unhandled(exception_frame *frame, uint64_t type);
+
+#endif
@@ -0,0 +1,368 @@
+#include "job.h"
+#include "cli.h"
+#include "command.h"
+#include "timer.h"
+#include "machine.h"
+#include "lineedit.h"
+#include "pmu.h"
+#include "trace.h"
+#include "bench.h"
+#include "stack.h"
+
+#define JOB_FREE    0
+#define JOB_RUNNING 1
+#define JOB_DONE    2
+
+typedef struct {
+    int state;
+    int cancelled;
+    int status;
+    int overflowed;   // The job's stack guard was found overwritten
+    unsigned long sp; // Saved while the job is not running
+    char line[JOB_LINE_SIZE];
+    int argc;
+    char *argv[CMD_MAX_ARGS];
+    pmu_snapshot pmu; // The job's own counter values while it is switched out
+    output_sink sink; // The job's printf sink while it is switched out
+    unsigned long stack[JOB_STACK_SIZE / sizeof(unsigned long)] __attribute__((aligned(16)));
+} job_t;
+
+static job_t jobs[JOB_MAX];
+static job_t *current = NULL;         // Running job, NULL on the CLI's stack
+static unsigned long cli_sp;          // The CLI's stack while a job runs
+static pmu_snapshot cli_pmu;          // The CLI's counter values while a job runs
+static output_sink cli_sink;          // The CLI's printf sink while a job runs
+static uint64_t slice_end = 0;        // When the running code should yield
+static int foreground_cancelled = 0;  // Ctrl-C during a foreground command
+
+// Stack names for the 'stacks' report, one per slot
+static const char *const stack_names[JOB_MAX] = {"job1", "job2", "job3", "job4"};
+
+// Keys read by job_poll() during a foreground command, for the CLI
+static char pushback[JOB_PUSHBACK_SIZE];
+static int pushback_head = 0, pushback_tail = 0;
+
+// switch.S
+void job_switch(unsigned long *save_sp, unsigned long next_sp);
+void job_start();
+
+/**
+ * Sink of jobs started in machine mode, whose output cannot be framed
+ */
+static void job_discard(char *string) {
+}
+
+/**
+ * First C code of a job, on its own stack
+ */
+void job_main(job_t *job) {
+    job->status = runCommand(job->argc, job->argv);
+    job->state = JOB_DONE;
+    job_switch(&job->sp, cli_sp);
+}
+
+/**
+ * Start a command as a background job
+ * @return the job number (1-based), or 0 if every job slot is busy
+ */
+int job_spawn(int argc, char **argv) {
+    for (int id = 0; id < JOB_MAX; id++) {
+        job_t *job = &jobs[id];
+        if (job->state != JOB_FREE) {
+            continue;
+        }
+
+        // Copy the words one after the other, each NUL-terminated
+        int n = 0;
+        job->argc = 0;
+        for (int i = 0; i < argc && i < CMD_MAX_ARGS; i++) {
+            int length = strlen(argv[i]);
+            if (n + length + 1 > JOB_LINE_SIZE) {
+                break;
+            }
+            strncpy(job->line + n, argv[i], length + 1);
+            job->argv[job->argc++] = job->line + n;
+            n += length + 1;
+        }
+
+        // Paint the stack for its high-water mark, then build the initial frame
+        // for job_switch: x19 = job, x30 = job_start, rest zero
+        stack_paint(job->stack, JOB_STACK_SIZE);
+        stack_register(stack_names[id], job->stack, JOB_STACK_SIZE);
+        unsigned long *frame = &job->stack[JOB_STACK_SIZE / sizeof(unsigned long) - 20];
+        for (int i = 0; i < 20; i++) {
+            frame[i] = 0;
+        }
+        frame[0] = (unsigned long)job;
+        frame[11] = (unsigned long)job_start;
+        job->sp = (unsigned long)frame;
+
+        job->pmu = (pmu_snapshot){0};
+        // The console the job was started from; not the capture of a command that polls
+        job->sink = machine_mode() ? job_discard : getOutputSink();
+        job->cancelled = 0;
+        job->overflowed = 0;
+        job->status = CMD_OK;
+        job->state = JOB_RUNNING;
+        return id + 1;
+    }
+    return 0;
+}
+
+/**
+ * Run every background job for one slice; only the CLI's stack may call this
+ */
+static void job_run_all() {
+    if (current) {
+        return;
+    }
+    for (int id = 0; id < JOB_MAX; id++) {
+        if (jobs[id].state == JOB_RUNNING) {
+            current = &jobs[id];
+            slice_end = timer_ticks() + timer_usec_to_ticks(JOB_SLICE_USEC);
+            pmu_save(&cli_pmu);
+            pmu_restore(&current->pmu);
+            cli_sink = setOutputSink(current->sink);
+            job_switch(&cli_sp, current->sp);
+            current->sink = setOutputSink(cli_sink);
+            pmu_save(&current->pmu);
+            pmu_restore(&cli_pmu);
+            if (!current->overflowed && !stack_intact(current->stack)) {
+                // Too late to undo the damage; stop the job as soon as it polls
+                current->overflowed = 1;
+                current->cancelled = 1;
+            }
+            current = NULL;
+        }
+    }
+}
+
+/**
+ * Read pending input during a foreground command: Ctrl-C cancels it, other
+ * keys are kept for the CLI. Once the pushback is full the rest stays in the
+ * RX FIFO instead of being dropped.
+ */
+static void job_read_input() {
+    while (!(UART0_FR & UART0_FR_RXFE) && (pushback_tail + 1) % JOB_PUSHBACK_SIZE != pushback_head) {
+        char c = uart_getc();
+        if (c == KEY_INTERRUPT) {
+            foreground_cancelled = 1;
+        } else {
+            pushback[pushback_tail] = c;
+            pushback_tail = (pushback_tail + 1) % JOB_PUSHBACK_SIZE;
+        }
+    }
+}
+
+/**
+ * Called regularly by long-running code: lets the others run once the
+ * current slice is over. Not traced, as it runs in every busy loop.
+ * @return 1 if the running command has been cancelled
+ */
+NO_TRACE int job_poll() {
+    if (current) {
+        if (timer_ticks() >= slice_end) {
+            job_t *job = current;
+            job_switch(&job->sp, cli_sp);
+        }
+        return current->cancelled;
+    }
+
+    // Foreground command: watch for Ctrl-C and keep the jobs going
+    if (timer_ticks() >= slice_end) {
+        job_read_input();
+        job_run_all();
+        slice_end = timer_ticks() + timer_usec_to_ticks(JOB_SLICE_USEC);
+    }
+    return foreground_cancelled;
+}
+
+/**
+ * Report finished jobs at the prompt (not in machine mode, where "fg"
+ * collects them so frames stay intact)
+ */
+static void job_report() {
+    if (machine_mode()) {
+        return;
+    }
+    for (int id = 0; id < JOB_MAX; id++) {
+        if (jobs[id].state == JOB_DONE) {
+            printf("\n[%d] Done  %s (status %d)%s\n", id + 1, jobs[id].argv[0], jobs[id].status,
+                   jobs[id].overflowed ? ", stack overflow" : "");
+            jobs[id].state = JOB_FREE;
+            line_redraw();
+        }
+    }
+}
+
+/**
+ * CLI input: wait for a key while running the background jobs
+ */
+char job_getc() {
+    foreground_cancelled = 0;
+    while (1) {
+        if (pushback_head != pushback_tail) {
+            char c = pushback[pushback_head];
+            pushback_head = (pushback_head + 1) % JOB_PUSHBACK_SIZE;
+            return c;
+        }
+        if (!(UART0_FR & UART0_FR_RXFE)) {
+            return uart_getc();
+        }
+        job_run_all();
+        job_report();
+    }
+}
+
+/**
+ * Whether the running code is a background job rather than the CLI. Only
+ * the CLI reads the console: job_getc() would never yield from a job.
+ */
+int job_is_background() {
+    return current != NULL;
+}
+
+/**
+ * State of a job slot (0-based) for status displays
+ * @return "Running", "Killed" or "Done", or NULL for a free slot; *name is the command
+ */
+const char *job_status(int id, const char **name) {
+    if (id < 0 || id >= JOB_MAX || jobs[id].state == JOB_FREE) {
+        return NULL;
+    }
+
+    job_t *job = &jobs[id];
+    *name = job->argv[0];
+    if (job->state == JOB_DONE) {
+        return "Done";
+    }
+    return job->cancelled ? "Killed" : "Running";
+}
+
+/**
+ * Job number from "2" or "%2"; returns NULL if there is no such job
+ */
+static job_t *job_lookup(const char *arg) {
+    unsigned long id;
+
+    if (*arg == '%') {
+        arg++;
+    }
+    if (!parse_number(arg, &id) || id < 1 || id > JOB_MAX || jobs[id - 1].state == JOB_FREE) {
+        return NULL;
+    }
+    return &jobs[id - 1];
+}
+
+static int cmdJobs(int argc, char **argv) {
+    printf("\n");
+    for (int id = 0; id < JOB_MAX; id++) {
+        job_t *job = &jobs[id];
+        if (job->state == JOB_FREE) {
+            continue;
+        }
+        printf("[%d] %s", id + 1, job->state == JOB_RUNNING ? (job->cancelled ? "Killed " : "Running") : "Done   ");
+        for (int i = 0; i < job->argc; i++) {
+            printf(" %s", job->argv[i]);
+        }
+        if (job->state == JOB_DONE) {
+            printf(" (status %d)", job->status);
+        }
+        printf("\n");
+    }
+    return CMD_OK;
+}
+REGISTER_COMMAND("jobs", cmdJobs, 0, 0, "",
+                 "List background jobs.",
+                 "Lists the jobs started with 'command &'.");
+
+static int cmdFg(int argc, char **argv) {
+    job_t *job = NULL;
+
+    // Default to the most recently started job still present
+    if (argc == 2) {
+        job = job_lookup(argv[1]);
+    } else {
+        for (int id = JOB_MAX - 1; id >= 0 && !job; id--) {
+            job = jobs[id].state != JOB_FREE ? &jobs[id] : NULL;
+        }
+    }
+    if (!job) {
+        printf("\nNo such job\n");
+        return CMD_ERR_INVALID;
+    }
+
+    // Wait for it; Ctrl-C is passed on as a cancellation
+    while (job->state == JOB_RUNNING) {
+        if (job_poll()) {
+            job->cancelled = 1;
+        }
+        job_run_all();
+    }
+    job->state = JOB_FREE;
+    return job->status;
+}
+REGISTER_COMMAND("fg", cmdFg, 0, 1, "[job]",
+                 "Wait for a background job.",
+                 "Waits for a job to finish and returns its status; Ctrl-C cancels it. Example: fg 1");
+
+static int cmdKill(int argc, char **argv) {
+    job_t *job = job_lookup(argv[1]);
+    if (!job) {
+        printf("\nNo such job\n");
+        return CMD_ERR_INVALID;
+    }
+    job->cancelled = 1;
+    return CMD_OK;
+}
+REGISTER_COMMAND("kill", cmdKill, 1, 1, "<job>",
+                 "Cancel a background job.",
+                 "Asks a job to stop; it ends the next time it checks for cancellation. Example: kill %1");
+
+static int cmdSleep(int argc, char **argv) {
+    unsigned long msec;
+    if (!parse_number(argv[1], &msec) || msec > JOB_MAX_SLEEP_MSEC) {
+        printf("\nMilliseconds must be between 0 and %d\n", JOB_MAX_SLEEP_MSEC);
+        return CMD_ERR_INVALID;
+    }
+
+    uint64_t end = timer_ticks() + timer_usec_to_ticks((uint64_t)msec * 1000);
+    while (timer_ticks() < end) {
+        if (job_poll()) {
+            return CMD_ERR_CANCELLED;
+        }
+    }
+    return CMD_OK;
+}
+REGISTER_COMMAND("sleep", cmdSleep, 1, 1, "<msec>",
+                 "Wait for a number of milliseconds.",
+                 "Waits without blocking background jobs; Ctrl-C stops it. Example: sleep 5000 &");
+
+// Context switch benchmark: a partner stack that switches straight back
+static unsigned long bench_stack[512] __attribute__((aligned(16)));
+static unsigned long bench_sp, bench_partner_sp;
+
+static void benchPartner() {
+    for (;;) {
+        job_switch(&bench_partner_sp, bench_sp);
+    }
+}
+
+static void benchSwitch(unsigned int iterations, unsigned long arg) {
+    // Same initial frame as a job's, entering benchPartner on the first switch
+    if (!bench_partner_sp) {
+        stack_paint(bench_stack, sizeof(bench_stack));
+        stack_register("bench", bench_stack, sizeof(bench_stack));
+    }
+    unsigned long *frame = &bench_stack[512 - 20];
+    for (int i = 0; i < 20; i++) {
+        frame[i] = 0;
+    }
+    frame[11] = (unsigned long)benchPartner;
+    bench_partner_sp = (unsigned long)frame;
+
+    for (unsigned int i = 0; i < iterations; i++) {
+        job_switch(&bench_sp, bench_partner_sp);
+    }
+}
+REGISTER_BENCHMARK("job_switch", benchSwitch, 0, 0);
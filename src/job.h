@@ -0,0 +1,35 @@
+// -----------------------------------job.h -------------------------------------
+#ifndef JOB_H
+#define JOB_H
+
+/* Background jobs ("command &").
+ * Each job runs a command on its own stack, cooperatively: the CLI runs the
+ * jobs while it waits for input, and a job gives the CLI its turn when it
+ * calls job_poll(), at most once per JOB_SLICE_USEC. Long-running code must
+ * call job_poll() in its loops; it also returns 1 once the command has been
+ * cancelled, by Ctrl-C for the foreground command or by kill for a job.
+ * Keys typed while a foreground command polls are kept for the CLI. Each job
+ * also keeps its own PMU counter values (see pmu.h) and printf sink: the
+ * console it was started from, so its output never lands in another
+ * command's machine mode capture or quiet run. Output of jobs started in
+ * machine mode is discarded, as it cannot be framed. Job stacks are painted
+ * at spawn for 'stacks', and a job whose stack guard is overwritten is
+ * cancelled (see stack.h). */
+
+#define JOB_MAX 4
+#define JOB_STACK_SIZE 32768  // printf alone needs 10 KB
+#define JOB_LINE_SIZE 100     // Same as the CLI's MAX_CMD_SIZE
+#define JOB_SLICE_USEC 2000
+#define JOB_PUSHBACK_SIZE 32
+#define JOB_MAX_SLEEP_MSEC 86400000 // sleep: one day
+
+#define KEY_INTERRUPT 0x03 // Ctrl-C
+
+/* Function prototypes */
+int job_spawn(int argc, char **argv);
+int job_poll();
+char job_getc();
+int job_is_background();
+const char *job_status(int id, const char **name);
+
+#endif
@@ -1,22 +1,57 @@
 #include "cli.h"
+#include "pmu.h"
+#include "irq.h"
+#include "history.h"
+#include "lineedit.h"
+#include "machine.h"
+#include "script.h"
+#include "job.h"
+#include "stack.h"
 
 #define MAX_CMD_SIZE 100
-#define CMD_TRACKER_SIZE 20
-char CMD_TRACKER[CMD_TRACKER_SIZE][MAX_CMD_SIZE];
-int LAST_STATE_TRACKER_INDEX = 0;
-int CMD_TRACKER_INDEX = 0;
-int accessHistory = 0;
 
-void navigateCommandHistory(char *cli_buffer, int *index, int direction);
+// History browsing: the entry on the line (-1 for the line being typed) and
+// a copy of the line being typed, restored when moving back past the newest entry
+static int historyAge = -1;
+static char draft[MAX_CMD_SIZE];
+
+// Reverse search state
+static int searching = 0;
+static char searchPattern[MAX_CMD_SIZE];
+static int searchLength = 0;
+static int searchAge = -1; // Matching entry, -1 if none
+
+// Constructors (link.ld): the gcov runtime's registrations in a pgo-gen build
+extern void (*__init_array_start[])(void);
+extern void (*__init_array_end[])(void);
+
 void cli();
 
 void main() {
+    // Paint the boot stack for 'stacks', before interrupts can use it
+    stack_init();
+
+    for (void (**constructor)(void) = __init_array_start; constructor < __init_array_end; constructor++) {
+        (*constructor)();
+    }
+
     // Initialize UART
     uart_init();
 
+    // Start the cycle counter used by the benchmarks
+    pmu_init();
+
+    // Take timer interrupts (the profiler)
+    irq_init();
+
     // Print welcome message
     home();
-    printf("DoorOS> ");
+
+    // Apply the boot configuration script linked into the image
+    script_autorun();
+
+    printf(PROMPT);
+    line_reset();
 
     // Command Line Interpreter
     while (1) {
@@ -24,117 +59,148 @@ void main() {
     }
 }
 
-// Function to handle the command history navigation
-void navigateCommandHistory(char *cli_buffer, int *index, int direction) {
-    if (direction == 1 && CMD_TRACKER_INDEX < CMD_TRACKER_SIZE) {
-        if (CMD_TRACKER_INDEX <= LAST_STATE_TRACKER_INDEX) {
-            CMD_TRACKER_INDEX++;
+// Function to handle the command history navigation (1 = older, -1 = newer)
+static void navigateCommandHistory(int direction) {
+    if (direction == 1 && historyAge + 1 < history_count()) {
+        if (historyAge == -1) {
+            strncpy(draft, line_text(), MAX_CMD_SIZE);
         }
-        if (CMD_TRACKER_INDEX == 20) {
-            cli_buffer[0] = '\0'; // Clear the buffer if at the newest command
-            uart_puts("\b \b");
-        } else {
-            strncpy(cli_buffer, CMD_TRACKER[CMD_TRACKER_INDEX], MAX_CMD_SIZE - 1);
-            cli_buffer[MAX_CMD_SIZE - 1] = '\0';
+        historyAge++;
+        line_set(history_get(historyAge));
+    } else if (direction == -1 && historyAge >= 0) {
+        historyAge--;
+        line_set(historyAge == -1 ? draft : history_get(historyAge));
+    }
+}
+
+// Function to draw the reverse search prompt and its current match
+static void drawSearch() {
+    const char *match = searchAge >= 0 ? history_get(searchAge) : "";
+    printf("\r(%sreverse-i-search)`%s': %s\033[K", (searchAge < 0 && searchLength > 0) ? "failed " : "",
+           searchPattern, match);
+}
+
+// Function to handle a key while reverse searching
+// Returns 1 when the key ends the search and should also be processed as usual
+static int reverseSearch(int key) {
+    if (key == KEY_CTRL('R')) {
+        // Next older match
+        int age = searchAge >= 0 ? history_search(searchPattern, searchAge + 1) : -1;
+        if (age >= 0) {
+            searchAge = age;
         }
-    } else if (direction == -1 && CMD_TRACKER_INDEX > 0) {
-        if(accessHistory == 1){
-            CMD_TRACKER_INDEX--;
+    } else if (key == KEY_BACKSPACE || key == '\b') {
+        if (searchLength > 0) {
+            searchPattern[--searchLength] = '\0';
         }
-        else {
-            accessHistory = 1;
-            LAST_STATE_TRACKER_INDEX = CMD_TRACKER_INDEX;
+        searchAge = history_search(searchPattern, 0);
+    } else if (key >= ' ' && key < KEY_BACKSPACE) {
+        if (searchLength < MAX_CMD_SIZE - 1) {
+            searchPattern[searchLength++] = key;
+            searchPattern[searchLength] = '\0';
+        }
+        // The current match is the most recent that could still match
+        searchAge = history_search(searchPattern, searchAge >= 0 ? searchAge : 0);
+    } else {
+        // Leave the search: Ctrl-G keeps the line, anything else takes the match and then acts on it
+        searching = 0;
+        line_redraw();
+        if (key == KEY_CTRL('G')) {
+            return 0;
+        }
+        if (searchAge >= 0) {
+            historyAge = searchAge;
+            line_set(history_get(searchAge));
+        }
+        return 1;
+    }
+
+    drawSearch();
+    return 0;
+}
+
+// Function to complete the word before the cursor
+static void complete() {
+    char head[MAX_CMD_SIZE];
+    int cursor = line_cursor();
+    int index = cursor;
+
+    strncpy(head, line_text(), MAX_CMD_SIZE);
+    head[cursor] = '\0';
+    if (autoComplete(head, &index)) {
+        line_redraw();
+    }
+    line_insert(head + cursor);
+}
+
+// Machine mode: collect a line without echo or editing and answer it with a frame
+static void machineCli(char c) {
+    static char line[MAX_CMD_SIZE];
+    static int length = 0;
+
+    if (c != '\n') {
+        if (length < MAX_CMD_SIZE - 1) {
+            line[length++] = c;
         }
-        
-        strncpy(cli_buffer, CMD_TRACKER[CMD_TRACKER_INDEX], MAX_CMD_SIZE - 1);
-        cli_buffer[MAX_CMD_SIZE - 1] = '\0';
+        return;
+    }
+
+    line[length] = '\0';
+    if (length > 0) {
+        machine_run(line);
+    }
+    length = 0;
+
+    // "mode human" was the last command
+    if (!machine_mode()) {
+        printf(PROMPT);
+        line_reset();
     }
-    *index = strlen(cli_buffer);
 }
 
 // Command Line Interpreter
 void cli() {
-    static char cli_buffer[MAX_CMD_SIZE];
-    static int index = 0;
-    static int reset = 1;
+    if (machine_mode()) {
+        machineCli(job_getc());
+        return;
+    }
 
-    char c = uart_getc();
+    int key = line_decode(job_getc());
 
-    // Ignore non-printable characters
-    if ((c != '\0' && (c != '\b' && c != 0x7F && c != 0x08)) && (c != '+' && c != '_')) {
-        uart_sendc(c);
-        
-    }
-    
-    if (c != '+' && c != '_' && accessHistory == 1) { // Reset the history access tracker
-        accessHistory = 0;
-        CMD_TRACKER_INDEX = LAST_STATE_TRACKER_INDEX;
+    if (key == 0 || (searching && !reverseSearch(key))) {
+        return;
     }
 
     // Process the command when Enter is pressed
-    if (c == '\n' || index >= MAX_CMD_SIZE - 1) {
-        if (c == '\n') {
-            cli_buffer[index] = '\0';
-        } else {
-            cli_buffer[MAX_CMD_SIZE - 1] = '\0'; // Ensure null-terminated
-        }
+    if (key == '\n') {
+        uart_sendc('\n');
+        processCommand(line_text());
+        history_add(line_text());
 
-        if (c == '\n' || index >= MAX_CMD_SIZE - 1) {
-            processCommand(cli_buffer);
-
-            // Add the command to command history
-            if (CMD_TRACKER_INDEX >= CMD_TRACKER_SIZE) {
-                // Shift the history to make space for the new command
-                for (int i = 0; i < CMD_TRACKER_SIZE - 1; i++) {
-                    strncpy(CMD_TRACKER[i], CMD_TRACKER[i + 1], MAX_CMD_SIZE - 1);
-                    CMD_TRACKER[i][MAX_CMD_SIZE - 1] = '\0';
-                }
-                CMD_TRACKER_INDEX = CMD_TRACKER_SIZE - 1;
-            }
-            strncpy(CMD_TRACKER[CMD_TRACKER_INDEX], cli_buffer, MAX_CMD_SIZE - 1);
-            CMD_TRACKER[CMD_TRACKER_INDEX][MAX_CMD_SIZE - 1] = '\0';
-            CMD_TRACKER_INDEX++;
-
-            reset = 1;
-            index = 0;
-        }
-
-        if (reset) {
-            printf("\nDoorOS> ");
-            reset = 0;
-        }
-        accessHistory = 0;
-        LAST_STATE_TRACKER_INDEX = CMD_TRACKER_INDEX;
-    } else if (c == '\t') { // Tab completion
-        autoComplete(cli_buffer, &index);
-    } else if (c == 0x7F || c == 0x08 || c == '\b') {
-        if (index > 0) {
-            uart_sendc(0x08);
-            uart_sendc(' ');
-            uart_sendc(0x08);
-            index--;
-            cli_buffer[index] = '\0';
-        }
-    } else if (c == '_') { // Move down in history using shift and -
-        for(int i = 0; i < strlen(cli_buffer)+1; i++){
-            uart_sendc(0x08);
-            uart_sendc(' ');
-            uart_sendc(0x08);
-        }
-        navigateCommandHistory(cli_buffer, &index, -1);
-        
-        printf("\rDoorOS> %s", cli_buffer);
-    } else if (c == '+') { // Move up in history
-        for(int i = 0; i < strlen(cli_buffer)+1; i++){
-            uart_sendc(0x08);
-            uart_sendc(' ');
-            uart_sendc(0x08);
+        historyAge = -1;
+        if (!machine_mode()) {
+            printf("\n" PROMPT);
+            line_reset();
         }
-        navigateCommandHistory(cli_buffer, &index, 1);
-        printf("\rDoorOS> %s", cli_buffer);
+    } else if (key == KEY_INTERRUPT) {
+        // Ctrl-C at the prompt abandons the line
+        uart_puts("^C");
+        historyAge = -1;
+        printf("\n" PROMPT);
+        line_reset();
+    } else if (key == KEY_UP) {
+        navigateCommandHistory(1);
+    } else if (key == KEY_DOWN) {
+        navigateCommandHistory(-1);
+    } else if (key == KEY_CTRL('R')) {
+        searching = 1;
+        searchLength = 0;
+        searchPattern[0] = '\0';
+        searchAge = history_search(searchPattern, 0);
+        drawSearch();
+    } else if (key == '\t') { // Tab completion
+        complete();
     } else {
-        cli_buffer[index] = c;
-        index++;
-        reset = 1; // A new character indicates a new command
+        line_key(key);
     }
 }
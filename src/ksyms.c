@@ -0,0 +1,58 @@
+#include "ksyms.h"
+
+typedef struct {
+    uint32_t address;
+    uint32_t name;
+} ksym_entry;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t count;
+    ksym_entry entries[];
+} ksym_table;
+
+// Provided by link.ld around the ".ksyms" section
+extern const char __ksyms_start[];
+extern const char __ksyms_end[];
+
+static const ksym_table *ksyms_table() {
+    const ksym_table *table = (const ksym_table *)__ksyms_start;
+    if (__ksyms_end - __ksyms_start < (long)sizeof(ksym_table) || table->magic != KSYMS_MAGIC) {
+        return NULL;
+    }
+    return table;
+}
+
+int ksyms_available() {
+    return ksyms_table() != NULL;
+}
+
+/**
+ * Function containing an address (binary search)
+ * @return its name, with *offset set to the distance from its start, or NULL
+ */
+const char *ksyms_lookup(uint64_t address, uint64_t *offset) {
+    const ksym_table *table = ksyms_table();
+    if (!table || table->count == 0 || address < table->entries[0].address) {
+        return NULL;
+    }
+
+    // Last entry starting at or below the address
+    uint32_t low = 0, high = table->count - 1;
+    while (low < high) {
+        uint32_t middle = low + (high - low + 1) / 2;
+        if (table->entries[middle].address <= address) {
+            low = middle;
+        } else {
+            high = middle - 1;
+        }
+    }
+
+    // An empty name marks the end of the code
+    const char *name = (const char *)&table->entries[table->count] + table->entries[low].name;
+    if (!*name) {
+        return NULL;
+    }
+    *offset = address - table->entries[low].address;
+    return name;
+}
@@ -0,0 +1,27 @@
+// -----------------------------------ksyms.h -------------------------------------
+#ifndef KSYMS_H
+#define KSYMS_H
+
+#include "gpio.h"
+#include "../gcclib/stddef.h"
+
+/* Kernel symbol table for on-target symbolization.
+ * The Makefile links the kernel once, lists its functions with nm, turns
+ * them into a .ksyms section with tools/gensyms.py and links again (the
+ * section comes after .data, so no function moves). Layout, little-endian:
+ *
+ *   u32 magic ("KSYM")  u32 count
+ *   count x { u32 address  u32 name offset }   sorted by address
+ *   NUL-terminated names
+ *
+ * A last entry with an empty name marks the end of the code.
+ * Built with KSYMS=0, or in the first pass, the section is empty and every
+ * lookup fails. */
+
+#define KSYMS_MAGIC 0x4D59534B // "KSYM"
+
+/* Function prototypes */
+int ksyms_available();
+const char *ksyms_lookup(uint64_t address, uint64_t *offset);
+
+#endif
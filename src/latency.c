@@ -0,0 +1,290 @@
+#include "latency.h"
+#include "irq.h"
+#include "timer.h"
+#include "uart.h"
+#include "command.h"
+#include "machine.h"
+#include "job.h"
+#include "utility.h"
+#include "bench.h"
+
+#define CNTP_CTL_ENABLE 1
+
+static latency_histogram irq_latency, wakeup_latency;
+static volatile int fired = 0;
+static volatile uint64_t fired_latency; // Ticks from the deadline to handler entry
+
+static unsigned char stream_source[LATENCY_STREAM_SIZE] __attribute__((aligned(64)));
+static unsigned char stream_destination[LATENCY_STREAM_SIZE] __attribute__((aligned(64)));
+
+static const char *const load_names[] = {"idle", "spin", "memory", "uart", NULL};
+
+/**
+ * Timer interrupt: timestamp first, then disarm and tell the waiting code
+ */
+static void latency_tick(exception_frame *frame) {
+    uint64_t now = timer_ticks();
+    uint64_t deadline;
+
+    asm volatile("mrs %0, cntp_cval_el0" : "=r"(deadline));
+    asm volatile("msr cntp_ctl_el0, xzr; isb");
+    fired_latency = now - deadline;
+    fired = 1;
+}
+
+/**
+ * Histogram bucket of a latency: exact, then LATENCY_SUB_BUCKETS per power of two
+ */
+static int latency_bucket(uint64_t ticks) {
+    if (ticks < LATENCY_LINEAR) {
+        return ticks;
+    }
+    int exponent = 63 - __builtin_clzll(ticks);
+    return LATENCY_LINEAR + (exponent - 7) * LATENCY_SUB_BUCKETS + ((ticks >> (exponent - 6)) & 63);
+}
+
+/**
+ * Largest latency that falls into a bucket
+ */
+static uint64_t latency_bucket_limit(int bucket) {
+    if (bucket < LATENCY_LINEAR) {
+        return bucket;
+    }
+    int exponent = (bucket - LATENCY_LINEAR) / LATENCY_SUB_BUCKETS + 7;
+    uint64_t sub = (bucket - LATENCY_LINEAR) % LATENCY_SUB_BUCKETS;
+    return ((LATENCY_SUB_BUCKETS + sub + 1) << (exponent - 6)) - 1;
+}
+
+static void latency_record(latency_histogram *histogram, uint64_t ticks) {
+    if (histogram->samples == 0 || ticks < histogram->min) {
+        histogram->min = ticks;
+    }
+    if (ticks > histogram->max) {
+        histogram->max = ticks;
+    }
+    histogram->samples++;
+    histogram->buckets[latency_bucket(ticks)]++;
+}
+
+/**
+ * Latency below which per_mille thousandths of the samples fall, in ticks
+ * (the top of its bucket, at most the maximum)
+ */
+static uint64_t latency_percentile(const latency_histogram *histogram, unsigned int per_mille) {
+    uint64_t target = (histogram->samples * per_mille + 999) / 1000;
+    uint64_t seen = 0;
+
+    for (int bucket = 0; bucket < LATENCY_BUCKETS; bucket++) {
+        seen += histogram->buckets[bucket];
+        if (seen >= target && seen > 0) {
+            uint64_t limit = latency_bucket_limit(bucket);
+            return limit < histogram->max ? limit : histogram->max;
+        }
+    }
+    return histogram->max;
+}
+
+/**
+ * One step of the chosen load, short enough to check the flag often
+ */
+static void latency_load(int load, unsigned int *offset) {
+    switch (load) {
+    case LATENCY_IDLE:
+        // With IRQs masked an interrupt still ends WFI, so one taken before it cannot be missed
+        irq_disable();
+        if (!fired) {
+            asm volatile("wfi");
+        }
+        irq_enable();
+        break;
+    case LATENCY_MEMORY:
+        memcpy(stream_destination + *offset, stream_source + *offset, LATENCY_STREAM_STEP);
+        *offset = (*offset + LATENCY_STREAM_STEP) % LATENCY_STREAM_SIZE;
+        break;
+    case LATENCY_UART:
+        while (!(UART0_FR & UART0_FR_TXFF)) {
+            UART0_DR = 0x55;
+        }
+        while (!(UART0_FR & UART0_FR_RXFE)) {
+            (void)UART0_DR;
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+/**
+ * Put UART0 in internal loopback (or back), so the flood stays off the console
+ */
+static void latency_uart_loopback(int enable) {
+    unsigned int cr = UART0_CR;
+
+    uart_drain();
+    UART0_CR = 0;
+    if (!enable) {
+        // Flush what the flood left in the FIFOs
+        unsigned int lcrh = UART0_LCRH;
+        UART0_LCRH = lcrh & ~UART0_LCRH_FEN;
+        UART0_LCRH = lcrh;
+        UART0_ICR = 0x7FF;
+    }
+    UART0_CR = enable ? cr | UART0_CR_LBE : cr & ~UART0_CR_LBE;
+}
+
+/**
+ * Leave the UART flood for a while and listen to the console
+ * @return 1 if the command was cancelled meanwhile
+ */
+static int latency_uart_listen() {
+    uint64_t end = timer_ticks() + timer_usec_to_ticks(LATENCY_UART_LISTEN_USEC);
+    int cancelled = 0;
+
+    latency_uart_loopback(0);
+    while (!cancelled && timer_ticks() < end) {
+        cancelled = job_poll();
+    }
+    latency_uart_loopback(1);
+    return cancelled;
+}
+
+/**
+ * Take samples interrupts under a load and fill the histograms
+ * @return CMD_OK, or CMD_ERR_CANCELLED
+ */
+static int latency_run(uint64_t samples, int load) {
+    uint64_t period = timer_usec_to_ticks(LATENCY_PERIOD_USEC);
+    uint32_t random = 0x9e3779b9;
+    unsigned int offset = 0;
+    int status = CMD_OK;
+
+    irq_latency = (latency_histogram){0};
+    wakeup_latency = (latency_histogram){0};
+    irq_set_timer_handler(latency_tick);
+    if (load == LATENCY_UART) {
+        latency_uart_loopback(1);
+    }
+
+    for (uint64_t n = 0; n < samples; n++) {
+        // A random gap, so the deadlines do not lock onto periodic work
+        random = random * 1664525 + 1013904223;
+        uint64_t deadline = timer_ticks() + period + (random >> 8) % period;
+
+        fired = 0;
+        asm volatile("msr cntp_cval_el0, %0" : : "r"(deadline));
+        asm volatile("msr cntp_ctl_el0, %0; isb" : : "r"((uint64_t)CNTP_CTL_ENABLE));
+        while (!fired) {
+            latency_load(load, &offset);
+            // In loopback job_poll() would read the flood; see latency_uart_listen()
+            if (load != LATENCY_UART && job_poll()) {
+                status = CMD_ERR_CANCELLED;
+                break;
+            }
+        }
+        uint64_t woken = timer_ticks();
+        if (status != CMD_OK) {
+            break;
+        }
+
+        latency_record(&irq_latency, fired_latency);
+        latency_record(&wakeup_latency, woken - deadline);
+
+        // Between samples, with the timer disarmed, so the pause is not measured
+        if (load == LATENCY_UART && (n + 1) % LATENCY_UART_POLL_SAMPLES == 0 && latency_uart_listen()) {
+            status = CMD_ERR_CANCELLED;
+            break;
+        }
+    }
+
+    asm volatile("msr cntp_ctl_el0, xzr; isb");
+    irq_set_timer_handler(NULL);
+    if (load == LATENCY_UART) {
+        latency_uart_loopback(0);
+    }
+    return status;
+}
+
+static void latency_report(const char *name, const latency_histogram *histogram) {
+    double ns = 1e9 / timer_frequency();
+    uint64_t p50 = latency_percentile(histogram, 500);
+    uint64_t p99 = latency_percentile(histogram, 990);
+    uint64_t p999 = latency_percentile(histogram, 999);
+
+    if (machine_mode()) {
+        printf("%s=samples:%lu,min_ns:%.0f,p50_ns:%.0f,p99_ns:%.0f,p999_ns:%.0f,max_ns:%.0f\n", name,
+               histogram->samples, histogram->min * ns, p50 * ns, p99 * ns, p999 * ns, histogram->max * ns);
+    } else {
+        printf("%6s %10.0f %10.0f %10.0f %10.0f %10.0f\n", name, histogram->min * ns, p50 * ns, p99 * ns,
+               p999 * ns, histogram->max * ns);
+    }
+}
+
+static const char *const *completeIrqLat(int arg, char **argv) {
+    return arg == 2 ? load_names : NULL;
+}
+
+static int cmdIrqLat(int argc, char **argv) {
+    unsigned long samples = LATENCY_DEFAULT_SAMPLES;
+    int load = LATENCY_IDLE;
+
+    if (argc >= 2) {
+        if (!parse_number(argv[1], &samples) || samples == 0 || samples > LATENCY_MAX_SAMPLES) {
+            printf("\nSamples must be between 1 and %d\n", LATENCY_MAX_SAMPLES);
+            return CMD_ERR_INVALID;
+        }
+    }
+    if (argc == 3) {
+        for (load = 0; load_names[load] && strcmp(load_names[load], argv[2]) != 0; load++) {
+        }
+        if (!load_names[load]) {
+            printf("\nUsage: irqlat [samples] [idle | spin | memory | uart]\n");
+            return CMD_ERR_USAGE;
+        }
+    }
+    if (irq_timer_busy()) {
+        printf("\nThe timer interrupt is in use (profile stop frees it)\n");
+        return CMD_ERR_UNAVAILABLE;
+    }
+
+    if (!machine_mode()) {
+        printf("\nMeasuring %lu interrupts, %s between them%s...\n", samples, load_names[load],
+               load == LATENCY_UART ? " (console mostly silent; press Ctrl-C until it stops)" : "");
+    }
+    if (latency_run(samples, load) == CMD_ERR_CANCELLED) {
+        return CMD_ERR_CANCELLED;
+    }
+
+    if (!machine_mode()) {
+        printf("  (ns)        min        p50        p99      p99.9        max\n");
+    }
+    latency_report("irq", &irq_latency);
+    latency_report("wakeup", &wakeup_latency);
+    return CMD_OK;
+}
+REGISTER_COMMAND_COMPLETE("irqlat", cmdIrqLat, completeIrqLat, 0, 2, "[samples] [idle | spin | memory | uart]",
+                          "Timer interrupt latency and jitter.",
+                          "Arms the timer for random deadlines and reports, over the samples (100000 by default), "
+                          "the min/p50/p99/p99.9/max time from the deadline to the interrupt handler (irq) and "
+                          "to the waiting command (wakeup). Between interrupts the core idles in WFI, spins, "
+                          "streams memory or floods UART0 in loopback (leaving it every 1000 samples to listen for "
+                          "Ctrl-C); background jobs add their own load. "
+                          "Example: irqlat 1000000 memory");
+
+/* Interrupt entry and exit: each operation arms an already expired deadline
+and waits for the handler. Unavailable while another command (e.g. the
+profiler) owns the timer interrupt. */
+static void benchIrq(unsigned int iterations, unsigned long arg) {
+    irq_set_timer_handler(latency_tick);
+    for (unsigned int i = 0; i < iterations; i++) {
+        fired = 0;
+        asm volatile("msr cntp_cval_el0, %0" : : "r"(timer_ticks()));
+        asm volatile("msr cntp_ctl_el0, %0; isb" : : "r"((uint64_t)CNTP_CTL_ENABLE));
+        while (!fired) {
+        }
+    }
+    irq_set_timer_handler(NULL);
+}
+static int benchIrqAvailable(void) {
+    return !irq_timer_busy();
+}
+REGISTER_BENCHMARK_IF("irq-timer", benchIrq, 0, 0, benchIrqAvailable);
@@ -0,0 +1,49 @@
+// -----------------------------------latency.h -------------------------------------
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include "gpio.h"
+
+/* Interrupt latency and jitter harness ('irqlat').
+ * Arms the EL1 physical timer (CNTP) for a deadline a random 100-200 us
+ * ahead, and the handler reads CNTPCT as its first action: handler entry
+ * minus CNTP_CVAL is the interrupt latency, including the vectors.S frame
+ * save and irq_dispatch(). The handler then disarms the timer and flags
+ * the waiting command; the time at which that code sees the flag is the
+ * wakeup latency. Between interrupts the command idles in WFI, spins, or
+ * generates load (memory streaming, a UART loopback flood), and it calls
+ * job_poll() throughout, so background jobs add their own load and
+ * scheduling delay ("bench memcpy &" first, for example). Loopback cuts the
+ * console off, so the UART load leaves it every LATENCY_UART_POLL_SAMPLES
+ * samples to listen for Ctrl-C for LATENCY_UART_LISTEN_USEC; keys sent
+ * meanwhile are lost.
+ *
+ * Latencies go into log-linear histograms in timer ticks: exact below
+ * LATENCY_LINEAR, then LATENCY_SUB_BUCKETS buckets per power of two (under
+ * 2% error), from which p50/p99/p99.9 are read. The timer interrupt is
+ * shared with the profiler; only one of them can use it at a time. */
+
+#define LATENCY_DEFAULT_SAMPLES 100000
+#define LATENCY_MAX_SAMPLES 100000000
+#define LATENCY_PERIOD_USEC 100 // Minimum gap between deadlines; up to twice this
+#define LATENCY_LINEAR 128      // Exact buckets: values below this many ticks
+#define LATENCY_SUB_BUCKETS 64  // Buckets per power of two above that (LATENCY_LINEAR / 2)
+#define LATENCY_BUCKETS (LATENCY_LINEAR + (64 - 7) * LATENCY_SUB_BUCKETS)
+#define LATENCY_STREAM_SIZE (512 * 1024) // Per buffer of the memory load: as large as the RPI3's L2
+#define LATENCY_STREAM_STEP 4096         // Copied between checks of the flag
+#define LATENCY_UART_POLL_SAMPLES 1000   // UART load: samples between returns to the console
+#define LATENCY_UART_LISTEN_USEC 50000   // and how long each one lasts
+
+/* Load run between interrupts */
+#define LATENCY_IDLE   0 // WFI
+#define LATENCY_SPIN   1 // Poll the flag
+#define LATENCY_MEMORY 2 // memcpy through LATENCY_STREAM_SIZE buffers
+#define LATENCY_UART   3 // Keep UART0's FIFOs full in internal loopback
+
+typedef struct {
+    uint32_t buckets[LATENCY_BUCKETS];
+    uint64_t samples;
+    uint64_t min, max; // Ticks
+} latency_histogram;
+
+#endif
@@ -0,0 +1,340 @@
+#include "lineedit.h"
+#include "uart.h"
+#include "utility.h"
+
+// The line being edited
+static char line[LINE_SIZE];
+static int length = 0;
+static int cursor = 0;
+
+// What the terminal currently shows after the prompt, and where its cursor is
+static char shown[LINE_SIZE];
+static int shown_length = 0;
+static int shown_cursor = 0;
+
+// Text removed by the last kill command, for yank
+static char kill_buffer[LINE_SIZE];
+
+/**
+ * Send "ESC [ n code"
+ */
+static void send_csi(int n, char code) {
+    uart_puts("\033[");
+    uart_dec(n);
+    uart_sendc(code);
+}
+
+/**
+ * Move the terminal cursor to a column of the shown text, whichever way is shorter
+ */
+static void move_to(int column) {
+    int n = column - shown_cursor;
+
+    if (n < 0) {
+        // Backspaces cost one byte each, ESC [ n D at least four
+        if (-n <= 4) {
+            while (n++ < 0) {
+                uart_sendc('\b');
+            }
+        } else {
+            send_csi(-n, 'D');
+        }
+    } else if (n > 0) {
+        // Re-sending the characters already on screen moves right too
+        if (n <= 4) {
+            for (int i = shown_cursor; i < column; i++) {
+                uart_sendc(shown[i]);
+            }
+        } else {
+            send_csi(n, 'C');
+        }
+    }
+    shown_cursor = column;
+}
+
+/**
+ * Bring the terminal in line with the edited line
+ */
+static void refresh() {
+    int same = 0;
+    int tail = 0;
+
+    while (same < length && same < shown_length && line[same] == shown[same]) {
+        same++;
+    }
+    while (tail < length - same && tail < shown_length - same &&
+           line[length - 1 - tail] == shown[shown_length - 1 - tail]) {
+        tail++;
+    }
+    int removed = shown_length - same - tail;
+    int added = length - same - tail;
+
+    if (removed > 0 || added > 0) {
+        move_to(same);
+        if (tail > 4 && (removed == 0 || added == 0)) {
+            // A pure insertion or deletion before a long tail: let the
+            // terminal shift the tail (ESC [ n @ / ESC [ n P) instead of resending it
+            if (removed > 0) {
+                send_csi(removed, 'P');
+            } else {
+                send_csi(added, '@');
+            }
+            for (int i = same; i < same + added; i++) {
+                uart_sendc(line[i]);
+            }
+            shown_cursor = same + added;
+        } else {
+            for (int i = same; i < length; i++) {
+                uart_sendc(line[i]);
+            }
+            if (shown_length > length) {
+                uart_puts("\033[K");
+            }
+            shown_cursor = length;
+        }
+        for (int i = same; i < length; i++) {
+            shown[i] = line[i];
+        }
+        shown_length = length;
+    }
+    move_to(cursor);
+}
+
+/**
+ * Remove count characters at position from the line, keeping them for yank
+ */
+static void cut(int position, int count, int keep) {
+    if (keep && count > 0) {
+        strncpy(kill_buffer, line + position, count);
+        kill_buffer[count] = '\0';
+    }
+    for (int i = position; i + count < length; i++) {
+        line[i] = line[i + count];
+    }
+    length -= count;
+    line[length] = '\0';
+    if (cursor > position) {
+        cursor = cursor > position + count ? cursor - count : position;
+    }
+}
+
+/**
+ * Start of the word before the cursor
+ */
+static int word_left() {
+    int i = cursor;
+    while (i > 0 && line[i - 1] == ' ') {
+        i--;
+    }
+    while (i > 0 && line[i - 1] != ' ') {
+        i--;
+    }
+    return i;
+}
+
+/**
+ * End of the word after the cursor
+ */
+static int word_right() {
+    int i = cursor;
+    while (i < length && line[i] == ' ') {
+        i++;
+    }
+    while (i < length && line[i] != ' ') {
+        i++;
+    }
+    return i;
+}
+
+/**
+ * Turn received bytes into keys, decoding ANSI sequences for arrows,
+ * Home/End/Delete, Ctrl+arrows and Alt-b/Alt-f
+ * @return the key, or 0 while a sequence is incomplete or was not recognised
+ */
+int line_decode(char c) {
+    static int state = 0;   // 0 plain, 1 after ESC, 2 in ESC [, 3 after ESC O
+    static int params[2];   // Numeric parameters of ESC [
+    static int param = 0;
+
+    switch (state) {
+        case 0:
+            if (c == KEY_ESC) {
+                state = 1;
+                return 0;
+            }
+            return (unsigned char)c;
+        case 1:
+            state = 0;
+            if (c == '[') {
+                params[0] = params[1] = param = 0;
+                state = 2;
+            } else if (c == 'O') {
+                state = 3;
+            } else if (c == 'b') {
+                return KEY_WORD_LEFT;
+            } else if (c == 'f') {
+                return KEY_WORD_RIGHT;
+            }
+            return 0;
+        case 2:
+            if (c >= '0' && c <= '9') {
+                params[param] = params[param] * 10 + (c - '0');
+                return 0;
+            }
+            if (c == ';') {
+                param = 1;
+                return 0;
+            }
+            state = 0;
+            switch (c) {
+                case 'A': return KEY_UP;
+                case 'B': return KEY_DOWN;
+                case 'C': return params[1] > 1 ? KEY_WORD_RIGHT : KEY_RIGHT; // ESC [ 1 ; 5 C is Ctrl+Right
+                case 'D': return params[1] > 1 ? KEY_WORD_LEFT : KEY_LEFT;
+                case 'H': return KEY_HOME;
+                case 'F': return KEY_END;
+                case '~':
+                    switch (params[0]) {
+                        case 1: case 7: return KEY_HOME;
+                        case 4: case 8: return KEY_END;
+                        case 3: return KEY_DELETE;
+                    }
+            }
+            return 0;
+        default:
+            state = 0;
+            switch (c) {
+                case 'A': return KEY_UP;
+                case 'B': return KEY_DOWN;
+                case 'C': return KEY_RIGHT;
+                case 'D': return KEY_LEFT;
+                case 'H': return KEY_HOME;
+                case 'F': return KEY_END;
+            }
+            return 0;
+    }
+}
+
+/**
+ * Apply an editing key: printable characters, Backspace/Delete, cursor
+ * motion (arrows, Home/End, Ctrl-A/E/B/F, word jumps) and kill/yank
+ * (Ctrl-K to end, Ctrl-U to start, Ctrl-W word, Ctrl-Y yank)
+ * @return 1 if the key was an editing key, 0 otherwise
+ */
+int line_key(int key) {
+    switch (key) {
+        case KEY_LEFT: case KEY_CTRL('B'):
+            if (cursor > 0) {
+                cursor--;
+            }
+            break;
+        case KEY_RIGHT: case KEY_CTRL('F'):
+            if (cursor < length) {
+                cursor++;
+            }
+            break;
+        case KEY_HOME: case KEY_CTRL('A'):
+            cursor = 0;
+            break;
+        case KEY_END: case KEY_CTRL('E'):
+            cursor = length;
+            break;
+        case KEY_WORD_LEFT:
+            cursor = word_left();
+            break;
+        case KEY_WORD_RIGHT:
+            cursor = word_right();
+            break;
+        case KEY_BACKSPACE: case '\b':
+            if (cursor > 0) {
+                cut(cursor - 1, 1, 0);
+            }
+            break;
+        case KEY_DELETE: case KEY_CTRL('D'):
+            if (cursor < length) {
+                cut(cursor, 1, 0);
+            }
+            break;
+        case KEY_CTRL('K'):
+            cut(cursor, length - cursor, 1);
+            break;
+        case KEY_CTRL('U'):
+            cut(0, cursor, 1);
+            break;
+        case KEY_CTRL('W'): {
+            int start = word_left();
+            cut(start, cursor - start, 1);
+            break;
+        }
+        case KEY_CTRL('Y'):
+            line_insert(kill_buffer);
+            return 1;
+        default:
+            if (key < ' ' || key >= KEY_BACKSPACE) {
+                return 0;
+            }
+            char text[2] = {key, '\0'};
+            line_insert(text);
+            return 1;
+    }
+    refresh();
+    return 1;
+}
+
+/**
+ * Start an empty line; the prompt has just been printed
+ */
+void line_reset() {
+    length = cursor = 0;
+    shown_length = shown_cursor = 0;
+    line[0] = '\0';
+}
+
+/**
+ * Print the prompt and the whole line again, after other output
+ */
+void line_redraw() {
+    uart_puts("\r" PROMPT);
+    shown_length = shown_cursor = 0;
+    uart_puts("\033[K");
+    refresh();
+}
+
+/**
+ * Replace the line (history recall), cursor at the end
+ */
+void line_set(const char *text) {
+    strncpy(line, text, LINE_SIZE - 1);
+    line[LINE_SIZE - 1] = '\0';
+    length = cursor = strlen(line);
+    refresh();
+}
+
+/**
+ * Insert text at the cursor, as much as fits
+ */
+void line_insert(const char *text) {
+    int n = strlen(text);
+
+    if (n > LINE_SIZE - 1 - length) {
+        n = LINE_SIZE - 1 - length;
+    }
+    for (int i = length - 1; i >= cursor; i--) {
+        line[i + n] = line[i];
+    }
+    for (int i = 0; i < n; i++) {
+        line[cursor + i] = text[i];
+    }
+    length += n;
+    cursor += n;
+    line[length] = '\0';
+    refresh();
+}
+
+const char *line_text() {
+    return line;
+}
+
+int line_cursor() {
+    return cursor;
+}
@@ -0,0 +1,42 @@
+// -----------------------------------lineedit.h -------------------------------------
+#ifndef LINEEDIT_H
+#define LINEEDIT_H
+
+/* Line editor for the CLI.
+ * Keeps the line being typed and a copy of what the terminal shows. Every
+ * edit changes the line first and then sends only the difference: cursor
+ * motion to the first changed column, the changed tail, an erase-to-end if
+ * the line got shorter, and motion back to the cursor. Motions use
+ * backspaces or re-sent characters when those are shorter than an ANSI
+ * sequence. Lines are assumed not to wrap. */
+
+#define LINE_SIZE 100 // Same as the CLI's MAX_CMD_SIZE
+#define PROMPT "DoorOS> "
+
+/* Keys decoded from escape sequences; other keys are their character code */
+#define KEY_UP         0x100
+#define KEY_DOWN       0x101
+#define KEY_LEFT       0x102
+#define KEY_RIGHT      0x103
+#define KEY_HOME       0x104
+#define KEY_END        0x105
+#define KEY_DELETE     0x106
+#define KEY_WORD_LEFT  0x107
+#define KEY_WORD_RIGHT 0x108
+
+/* Control characters */
+#define KEY_CTRL(c) ((c) & 0x1F)
+#define KEY_ESC     0x1B
+#define KEY_BACKSPACE 0x7F
+
+/* Function prototypes */
+int line_decode(char c);
+int line_key(int key);
+void line_reset();
+void line_redraw();
+void line_set(const char *text);
+void line_insert(const char *text);
+const char *line_text();
+int line_cursor();
+
+#endif
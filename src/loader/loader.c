@@ -0,0 +1,169 @@
+// -----------------------------------loader/loader.c -------------------------------------
+#include "../uart.h"
+#include "../timer.h"
+#include "../crc.h"
+
+/* Serial chainloader protocol (host side: tools/chainload.py)
+ *
+ *   loader -> host : "DOORLOAD\n"                       (repeated while idle)
+ *   host -> loader : 'B' <rate:u32>                      (optional) negotiate a bulk rate,
+ *                                                        see uart_negotiate_baud_rate()
+ *   host -> loader : 'L' <size:u32> <crc32:u32>          image header, little endian
+ *   loader -> host : "OK" | "SZ"                         header accepted / image too large
+ *   host -> loader : <size bytes>                        kernel image
+ *   loader -> host : "OK" | "CR" | "TO"                  booting / CRC mismatch / timeout
+ *
+ * The host gives up on any error reply, so every failure returns to the console rate at
+ * once (uart_burst_abort()), as does a negotiated rate with no request for LOADER_BURST_IDLE_MS.
+ * After "OK" the loader drains UART0 and jumps to KERNEL_LOAD_ADDR; the new kernel sets
+ * the console rate again in uart_init(), so the host switches back to it as well. */
+
+#define KERNEL_LOAD_ADDR 0x80000
+#define LOADER_STACK_SIZE 0x10000                   // Reserved below the relocated loader
+#define LOADER_IDLE_MS 1000                         // Interval between "DOORLOAD" requests
+#define LOADER_BYTE_TIMEOUT_MS 2000                 // Abort a transfer after this much silence
+#define LOADER_BURST_IDLE_MS 10000                  // Leave a negotiated rate after this long unused
+
+extern char _start[];                               // Link address of the loader
+
+/**
+ * Read a little-endian 32-bit value, -1 (all ones) with *ok cleared on timeout
+ */
+static unsigned int recv_u32(int *ok) {
+    unsigned int value = 0;
+    for (int i = 0; i < 4; i++) {
+        int c = uart_getc_timeout(LOADER_BYTE_TIMEOUT_MS);
+        if (c < 0) {
+            *ok = 0;
+            return 0xFFFFFFFF;
+        }
+        value |= (unsigned int)c << (8 * i);
+    }
+    return value;
+}
+
+/**
+ * Receive an image of the given size into the load address
+ * @return 1 on success, 0 on timeout
+ */
+static int recv_image(unsigned char *dest, unsigned int size) {
+    for (unsigned int i = 0; i < size; i++) {
+        int c = uart_getc_timeout(LOADER_BYTE_TIMEOUT_MS);
+        if (c < 0) {
+            return 0;
+        }
+        dest[i] = c;
+    }
+    return 1;
+}
+
+/**
+ * Write the received image back to the point of unification and drop stale
+ * instructions, so the new kernel is fetched from memory and not from the caches
+ */
+static void sync_caches(unsigned long start, unsigned long size) {
+    unsigned long ctr, line;
+
+    // CTR_EL0.DminLine is log2 of the smallest data cache line in words
+    asm volatile("mrs %0, ctr_el0" : "=r"(ctr));
+    line = 4UL << ((ctr >> 16) & 0xF);
+
+    for (unsigned long addr = start & ~(line - 1); addr < start + size; addr += line) {
+        asm volatile("dc cvau, %0" : : "r"(addr) : "memory");
+    }
+    asm volatile("dsb ish\n"
+                 "ic iallu\n"
+                 "dsb ish\n"
+                 "isb" : : : "memory");
+}
+
+/**
+ * Answer a failed request and go back to the console rate, where the next
+ * chainload.py run starts
+ */
+static void fail(char *reply, int *burst) {
+    uart_puts(reply);
+    if (*burst) {
+        uart_burst_abort();
+        *burst = 0;
+    }
+}
+
+/**
+ * Branch to the received kernel the same way the firmware enters it
+ */
+static void __attribute__((noreturn)) boot_kernel(unsigned long dtb) {
+    asm volatile("mov x0, %0\n"
+                 "mov x1, xzr\n"
+                 "mov x2, xzr\n"
+                 "mov x3, xzr\n"
+                 "br  %1"
+                 : : "r"(dtb), "r"((unsigned long)KERNEL_LOAD_ADDR)
+                 : "x0", "x1", "x2", "x3", "memory");
+    __builtin_unreachable();
+}
+
+void loader_main(unsigned long dtb) {
+    unsigned char *kernel = (unsigned char *)KERNEL_LOAD_ADDR;
+    unsigned int max_size = (unsigned long)_start - LOADER_STACK_SIZE - KERNEL_LOAD_ADDR;
+
+    uart_init();
+    uart_puts("\nDoorOS serial loader, max image ");
+    uart_dec(max_size);
+    uart_puts(" bytes\n");
+
+    int burst = 0; // At a negotiated rate
+    unsigned int idle_ms = 0;
+
+    while (1) {
+        uart_puts("DOORLOAD\n");
+
+        int c = uart_getc_timeout(LOADER_IDLE_MS);
+        if (c == 'B') {
+            int ok = 1;
+            unsigned int rate = recv_u32(&ok);
+            if (ok) {
+                burst = uart_negotiate_baud_rate(rate);
+            }
+            idle_ms = 0;
+            continue;
+        }
+        if (c != 'L') {
+            // Nobody is using the negotiated rate (the host may have been interrupted)
+            idle_ms += LOADER_IDLE_MS;
+            if (burst && idle_ms >= LOADER_BURST_IDLE_MS) {
+                uart_burst_abort();
+                burst = 0;
+            }
+            continue;
+        }
+        idle_ms = 0;
+
+        int ok = 1;
+        unsigned int size = recv_u32(&ok);
+        unsigned int crc = recv_u32(&ok);
+        if (!ok) {
+            fail("TO", &burst);
+            continue;
+        }
+        if (size == 0 || size > max_size) {
+            fail("SZ", &burst);
+            continue;
+        }
+        uart_puts("OK");
+
+        if (!recv_image(kernel, size)) {
+            fail("TO", &burst);
+            continue;
+        }
+        if (crc32(0, kernel, size) != crc) {
+            fail("CR", &burst);
+            continue;
+        }
+        uart_puts("OK");
+
+        uart_drain();
+        sync_caches(KERNEL_LOAD_ADDR, size);
+        boot_kernel(dtb);
+    }
+}
@@ -0,0 +1,67 @@
+#include "machine.h"
+#include "cli.h"
+#include "crc.h"
+
+static int enabled = 0;
+
+// Output of the command being run
+static char capture[MACHINE_CAPTURE_SIZE];
+static int capture_length = 0;
+static int capture_truncated = 0;
+static int capture_escape = 0; // Inside an ANSI escape sequence
+
+int machine_mode() {
+    return enabled;
+}
+
+void machine_set_mode(int mode) {
+    enabled = mode;
+}
+
+/**
+ * Output sink appending to the capture buffer, dropping ANSI escape sequences
+ */
+static void machine_capture_puts(char *string) {
+    for (; *string; string++) {
+        char c = *string;
+
+        // ESC, then everything up to the final byte (a letter, or ~) of the sequence
+        if (c == 0x1B) {
+            capture_escape = 1;
+            continue;
+        }
+        if (capture_escape) {
+            if ((c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || c == '~') {
+                capture_escape = 0;
+            }
+            continue;
+        }
+
+        if (capture_length == MACHINE_CAPTURE_SIZE - 1) {
+            capture_truncated = 1;
+            return;
+        }
+        capture[capture_length++] = c;
+    }
+}
+
+/**
+ * Run one command line and send its framed result
+ */
+void machine_run(const char *line) {
+    capture_length = 0;
+    capture_truncated = 0;
+    capture_escape = 0;
+
+    output_sink previous = setOutputSink(machine_capture_puts);
+    int status = processCommand(line);
+    setOutputSink(previous);
+    capture[capture_length] = '\0';
+
+    // Written through the selected sink so frames follow "output host"/"output file"
+    status = (status & 0x7F) | (capture_truncated ? MACHINE_STATUS_TRUNCATED : 0);
+    printf("%cF%02x%08x%08x\n", MACHINE_FRAME_START, status, capture_length, crc32(0, capture, capture_length));
+    if (capture_length > 0) {
+        getOutputSink()(capture);
+    }
+}
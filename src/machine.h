@@ -0,0 +1,26 @@
+// -----------------------------------machine.h -------------------------------------
+#ifndef MACHINE_H
+#define MACHINE_H
+
+/* Machine mode ("mode machine"), for host scripts driving the CLI.
+ * No echo, prompt, line editing or ANSI sequences. Each received line is run
+ * as a command and answered with exactly one frame:
+ *
+ *   SOH 'F' <status: 2 hex> <length: 8 hex> <crc32: 8 hex> LF <payload>
+ *
+ * The payload is the command's printf output with escape sequences
+ * removed, and the CRC-32 covers the payload only. The status is the
+ * handler's CMD_* code, with MACHINE_STATUS_TRUNCATED set if the output
+ * overflowed the capture buffer. Empty lines get no frame. Structured
+ * commands print key=value records, one per line, in this mode. */
+
+#define MACHINE_CAPTURE_SIZE 16384
+#define MACHINE_FRAME_START 0x01 // SOH
+#define MACHINE_STATUS_TRUNCATED 0x80
+
+/* Function prototypes */
+int machine_mode();
+void machine_set_mode(int enabled);
+void machine_run(const char *line);
+
+#endif
@@ -2,6 +2,7 @@
 #include "mbox.h" 
 #include "gpio.h"
 #include "uart.h"
+#include "bench.h"
 
 /* Mailbox Data Buffer (each element is 32-bit)*/
 /*
@@ -61,10 +62,12 @@ void mailbox_send(uint32_t msg, unsigned char channel) {
 * Make a mailbox call. Returns 0 on failure, non-zero on success
 */
 int mbox_call(unsigned int buffer_addr, unsigned char channel) {
+#ifdef MBOX_DEBUG
     //Check Buffer Address
     uart_puts("  Buffer Address: ");
     uart_hex(buffer_addr);
     uart_sendc('\n');
+#endif
 
     //Prepare Data (address of Message Buffer)
     unsigned int msg = (buffer_addr & ~0xF) | (channel & 0xF);
@@ -147,3 +150,15 @@ void mbox_buffer_setup(unsigned int buffer_addr, unsigned int tag_identifier, un
     va_end(args);
 }
 
+/**
+ * Mailbox round trip benchmark: ask the firmware for its revision
+ */
+static void benchMailbox(unsigned int iterations, unsigned long arg) {
+    unsigned int *response;
+
+    for (unsigned int i = 0; i < iterations; i++) {
+        mbox_buffer_setup(ADDR(mBuf), MBOX_TAG_GETFIRMWAREREVISION, &response);
+        mbox_call(ADDR(mBuf), MBOX_CH_PROP);
+    }
+}
+REGISTER_BENCHMARK("mbox-firmware", benchMailbox, 0, 0);
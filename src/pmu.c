@@ -0,0 +1,104 @@
+#include "pmu.h"
+
+// PMCR_EL0 bits
+#define PMCR_E  (1 << 0) // Enable all counters
+#define PMCR_P  (1 << 1) // Reset the event counters
+#define PMCR_C  (1 << 2) // Reset the cycle counter
+#define PMCR_LC (1 << 6) // 64-bit cycle counter overflow
+#define PMCR_N(pmcr) (((pmcr) >> 11) & 0x1F) // Number of event counters implemented
+
+// PMCNTENSET_EL0 bit for the cycle counter
+#define PMCNTEN_C (1UL << 31)
+
+// PMEVTYPER<n>_EL0 / PMCCFILTR_EL0: also count at EL2 (EL0 and EL1 are counted unless excluded)
+#define PMU_FILTER_NSH (1UL << 27)
+
+const pmu_event pmu_events[PMU_EVENT_COUNTERS] = {
+    [PMU_INSTRUCTIONS] = {PMU_EVENT_INST_RETIRED, "instructions", "instructions"},
+    [PMU_L1D_ACCESSES] = {PMU_EVENT_L1D_CACHE, "L1D accesses", "l1d_accesses"},
+    [PMU_L1D_REFILLS] = {PMU_EVENT_L1D_CACHE_REFILL, "L1D refills", "l1d_refills"},
+    [PMU_L2D_REFILLS] = {PMU_EVENT_L2D_CACHE_REFILL, "L2 refills", "l2_refills"},
+    [PMU_BR_MISPRED] = {PMU_EVENT_BR_MIS_PRED, "branch mispredicts", "branch_mispredicts"},
+    [PMU_EXCEPTIONS] = {PMU_EVENT_EXC_TAKEN, "exceptions taken", "exceptions"},
+};
+
+static int event_counters = 0; // Programmed by pmu_init(), at most PMU_EVENT_COUNTERS
+
+/**
+ * Select event counter n for PMXEVTYPER_EL0 / PMXEVCNTR_EL0
+ */
+static inline void select_counter(int n) {
+    asm volatile("msr pmselr_el0, %0; isb" : : "r"((unsigned long)n));
+}
+
+/**
+ * Enable the 64-bit cycle counter and the event counters, counting at every
+ * exception level. boot.S has already given EL1 all the counters (MDCR_EL2.HPMN).
+ */
+void pmu_init() {
+    unsigned long pmcr;
+
+    asm volatile("mrs %0, pmcr_el0" : "=r"(pmcr));
+    event_counters = PMCR_N(pmcr) < PMU_EVENT_COUNTERS ? PMCR_N(pmcr) : PMU_EVENT_COUNTERS;
+
+    asm volatile("msr pmccfiltr_el0, %0" : : "r"(PMU_FILTER_NSH));
+    for (int n = 0; n < event_counters; n++) {
+        select_counter(n);
+        asm volatile("msr pmxevtyper_el0, %0" : : "r"(PMU_FILTER_NSH | pmu_events[n].number));
+    }
+
+    asm volatile("msr pmcr_el0, %0" : : "r"((unsigned long)(PMCR_E | PMCR_P | PMCR_C | PMCR_LC)));
+    asm volatile("msr pmcntenset_el0, %0" : : "r"(PMCNTEN_C | ((1UL << event_counters) - 1)));
+    asm volatile("isb");
+}
+
+/**
+ * Number of event counters in use (the core may implement fewer than asked for)
+ */
+int pmu_event_counters() {
+    return event_counters;
+}
+
+/**
+ * Snapshot the cycle and event counters; missing counters read as zero
+ */
+void pmu_read(pmu_snapshot *snapshot) {
+    snapshot->cycles = pmu_cycles();
+    for (int n = 0; n < PMU_EVENT_COUNTERS; n++) {
+        unsigned long value = 0;
+        if (n < event_counters) {
+            select_counter(n);
+            asm volatile("mrs %0, pmxevcntr_el0" : "=r"(value));
+        }
+        snapshot->events[n] = value;
+    }
+}
+
+/**
+ * Counts between two snapshots; the event counters are 32 bits and may wrap once
+ */
+void pmu_diff(const pmu_snapshot *start, const pmu_snapshot *end, pmu_snapshot *delta) {
+    delta->cycles = end->cycles - start->cycles;
+    for (int n = 0; n < PMU_EVENT_COUNTERS; n++) {
+        delta->events[n] = (uint32_t)(end->events[n] - start->events[n]);
+    }
+}
+
+/**
+ * Save the counters of the context being switched out
+ */
+void pmu_save(pmu_snapshot *snapshot) {
+    pmu_read(snapshot);
+}
+
+/**
+ * Load the counters of the context being switched in
+ */
+void pmu_restore(const pmu_snapshot *snapshot) {
+    asm volatile("msr pmccntr_el0, %0" : : "r"(snapshot->cycles));
+    for (int n = 0; n < event_counters; n++) {
+        select_counter(n);
+        asm volatile("msr pmxevcntr_el0, %0" : : "r"(snapshot->events[n]));
+    }
+    asm volatile("isb");
+}
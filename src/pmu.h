@@ -0,0 +1,62 @@
+// -----------------------------------pmu.h -------------------------------------
+#ifndef PMU_H
+#define PMU_H
+
+#include "gpio.h"
+
+/* Performance Monitors Unit of the Cortex-A53/A72.
+ * PMCCNTR_EL0 counts CPU clock cycles once pmu_init() has enabled it, and
+ * up to PMU_EVENT_COUNTERS event counters count the events in pmu_events[].
+ * Snapshot the counters around a region with pmu_read() and subtract with
+ * pmu_diff(). Each background job has its own set of counter values: the
+ * scheduler swaps them with pmu_save()/pmu_restore(), so a region measured
+ * inside a command only counts that command's work. 'perf stat <command>'
+ * reports them for any command. */
+
+#define PMU_EVENT_COUNTERS 6
+
+/* ARMv8 common event numbers (PMEVTYPER<n>_EL0.evtCount) */
+#define PMU_EVENT_L1D_CACHE_REFILL 0x03
+#define PMU_EVENT_L1D_CACHE        0x04
+#define PMU_EVENT_INST_RETIRED     0x08
+#define PMU_EVENT_EXC_TAKEN        0x09
+#define PMU_EVENT_BR_MIS_PRED      0x10
+#define PMU_EVENT_L2D_CACHE_REFILL 0x17
+
+/* Indexes into pmu_snapshot.events, in the order pmu_init() programs them */
+#define PMU_INSTRUCTIONS 0
+#define PMU_L1D_ACCESSES 1
+#define PMU_L1D_REFILLS  2
+#define PMU_L2D_REFILLS  3
+#define PMU_BR_MISPRED   4
+#define PMU_EXCEPTIONS   5
+
+typedef struct {
+    uint64_t cycles;
+    uint64_t events[PMU_EVENT_COUNTERS];
+} pmu_snapshot;
+
+typedef struct {
+    unsigned int number; // Event number programmed into the counter
+    const char *name;    // For reports
+    const char *key;     // For machine mode records
+} pmu_event;
+
+extern const pmu_event pmu_events[PMU_EVENT_COUNTERS];
+
+/* Read the cycle counter */
+static inline uint64_t pmu_cycles(void) {
+    uint64_t cycles;
+    asm volatile("isb; mrs %0, pmccntr_el0" : "=r"(cycles) : : "memory");
+    return cycles;
+}
+
+/* Function prototypes */
+void pmu_init();
+int pmu_event_counters();
+void pmu_read(pmu_snapshot *snapshot);
+void pmu_diff(const pmu_snapshot *start, const pmu_snapshot *end, pmu_snapshot *delta);
+void pmu_save(pmu_snapshot *snapshot);
+void pmu_restore(const pmu_snapshot *snapshot);
+
+#endif
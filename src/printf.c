@@ -3,6 +3,9 @@
 // Define the maximum buffer size
 #define MAX_SIZE 10000
 
+// Current destination of printf output
+static output_sink outputSink = uart_puts;
+
 // Function to format and print an integer into a buffer
 void printInteger(char *buffer, int *buffer_index, int x, int width, int flag_zero_padding, int flag_left_justify, int flag_width) {
     char temp_buffer[12]; // Assuming 32-bit integers
@@ -128,9 +131,42 @@ void printFloat(char *buffer, int *buffer_index, double num, int width, int prec
     }
 }
 
+// Function to format and print an unsigned (possibly 64-bit) integer into a buffer
+void printUnsigned(char *buffer, int *buffer_index, unsigned long num, int width, int flag_zero_padding, int flag_left_justify) {
+    char temp_buffer[20]; // Digits of the largest 64-bit value
+    int temp_index = sizeof(temp_buffer) - 1;
+
+    // Convert to decimal string
+    do {
+        temp_buffer[temp_index--] = (num % 10) + '0';
+        num /= 10;
+    } while (num != 0);
+
+    // Calculate the number of padding characters needed
+    int diff = width - (sizeof(temp_buffer) - temp_index - 1);
+
+    if (!flag_left_justify) {
+        while (diff > 0) {
+            buffer[(*buffer_index)++] = flag_zero_padding ? '0' : ' ';
+            diff--;
+        }
+    }
+
+    while (temp_index < sizeof(temp_buffer) - 1) {
+        buffer[(*buffer_index)++] = temp_buffer[++temp_index];
+    }
+
+    if (flag_left_justify) {
+        while (diff > 0) {
+            buffer[(*buffer_index)++] = ' ';
+            diff--;
+        }
+    }
+}
+
 // Function to format and print a hexadecimal number into a buffer with width and zero padding
-void printHex(char *buffer, int *buffer_index, unsigned int num, int width, int flag_zero_padding, int flag_left_justify) {
-    char temp_buffer[8 * sizeof(unsigned int)]; // Hex buffer size
+void printHex(char *buffer, int *buffer_index, unsigned long num, int width, int flag_zero_padding, int flag_left_justify) {
+    char temp_buffer[2 * sizeof(unsigned long)]; // Hex buffer size
     int temp_index = sizeof(temp_buffer) - 1;
 
     // Convert to hexadecimal string
@@ -228,6 +264,7 @@ while (*format)
     // Initialize variables to hold formatting information
     int width = 0;
     int precision = 6; // Default precision is 6
+    int flag_precision = 0; // Precision given; for %s it caps the characters copied
     int flag_width = 0;
     int flag_zero_padding = 0; // Flag for zero padding
     int flag_left_justify = 0; // Flag for left-justified output
@@ -259,6 +296,7 @@ while (*format)
 
     // Check for precision specifier
     if (*format == '.') {
+        flag_precision = 1;
         format++;
 
         if (*format == '*') {
@@ -272,6 +310,13 @@ while (*format)
         }
     }
 
+    // Check for the long length modifier (applies to %u and %x)
+    int flag_long = 0;
+    if (*format == 'l') {
+        flag_long = 1;
+        format++;
+    }
+
     // Handle different format specifiers
     switch (*format) {
         // Handle integer formatting
@@ -289,22 +334,26 @@ while (*format)
         {
             char *str = va_arg(args, char *);
             int str_len = 0;
-            while (str[str_len])
+            while (str[str_len] && (!flag_precision || str_len < precision))
                 str_len++;
 
             int diff = width - str_len;
 
-            // Add padding spaces
-            while (diff > 0)
+            // Add padding spaces, after the string if left-justified
+            if (!flag_left_justify)
             {
-                buffer[buffer_index++] = ' ';
-                diff--;
+                addPadding(buffer, &buffer_index, diff, 0, 0);
             }
 
             // Copy the string to the buffer
-            while (*str)
+            for (int i = 0; i < str_len; i++)
             {
-                buffer[buffer_index++] = *str++;
+                buffer[buffer_index++] = str[i];
+            }
+
+            if (flag_left_justify)
+            {
+                addPadding(buffer, &buffer_index, diff, 0, 0);
             }
 
             format++; // Increment format pointer
@@ -316,8 +365,15 @@ while (*format)
             format++; // Increment format pointer
             break;
 
+        case 'u':
+            printUnsigned(buffer, &buffer_index, flag_long ? va_arg(args, unsigned long) : va_arg(args, unsigned int),
+                          width, flag_zero_padding, flag_left_justify);
+            format++; // Increment format pointer
+            break;
+
         case 'x':
-            printHex(buffer, &buffer_index, va_arg(args, unsigned int), width, flag_zero_padding, flag_left_justify);
+            printHex(buffer, &buffer_index, flag_long ? va_arg(args, unsigned long) : va_arg(args, unsigned int),
+                     width, flag_zero_padding, flag_left_justify);
             format++; // Increment format pointer
             break;
 
@@ -348,5 +404,21 @@ void printf(char *format, ...) {
     va_end(args);
 
     // Output the formatted string
-    uart_puts(buffer);
+    outputSink(buffer);
+}
+
+// Function to redirect printf output, returning the previous sink
+output_sink setOutputSink(output_sink sink) {
+    output_sink previous = outputSink;
+    outputSink = sink ? sink : uart_puts;
+    return previous;
+}
+
+// Output sink discarding everything, e.g. to time a command without its UART output
+void nullSink(char *string) {
+}
+
+// Function to return the current printf output sink
+output_sink getOutputSink() {
+    return outputSink;
 }
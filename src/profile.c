@@ -0,0 +1,293 @@
+#include "profile.h"
+#include "irq.h"
+#include "timer.h"
+#include "command.h"
+#include "machine.h"
+#include "utility.h"
+#include "unwind.h"
+#include "ksyms.h"
+
+#define CNTP_CTL_ENABLE 1
+
+typedef struct {
+    uint64_t words[PROFILE_RING_WORDS]; // Samples: depth, then the PCs innermost first
+    uint32_t used;    // Words stored, published after the sample itself
+    uint32_t samples;
+    uint32_t dropped; // Samples lost to a full ring
+} profile_ring;
+
+typedef struct {
+    uint32_t offset; // Of the first sample with this stack (or leaf PC) in the ring
+    uint32_t count;
+} profile_bucket;
+
+static profile_ring rings[PROFILE_CORES];
+static volatile int running = 0;
+static unsigned int rate = 0;  // Samples per second of the last run
+static uint64_t period;        // Timer ticks between samples
+
+// Samples per stack, rebuilt for each report or dump
+static profile_bucket table[PROFILE_TABLE_SIZE];
+static const profile_ring *table_ring; // Ring the offsets refer to
+static uint32_t untracked;             // Samples whose stack did not fit in the table
+
+/**
+ * Timer interrupt: record where the core was and schedule the next sample
+ */
+static void profile_tick(exception_frame *frame) {
+    profile_ring *ring = &rings[irq_core()];
+    uint32_t used = ring->used;
+
+    if (used + 1 + PROFILE_DEPTH <= PROFILE_RING_WORDS) {
+        int depth = unwind_exception(frame, &ring->words[used + 1], PROFILE_DEPTH);
+        ring->words[used] = depth;
+        ring->samples++;
+        __atomic_store_n(&ring->used, used + 1 + depth, __ATOMIC_RELEASE);
+    } else {
+        ring->dropped++;
+    }
+
+    // One period after the previous deadline, so that handler latency does not
+    // stretch the interval; skip ahead if interrupts were masked for too long
+    uint64_t deadline;
+    asm volatile("mrs %0, cntp_cval_el0" : "=r"(deadline));
+    deadline += period;
+    if (deadline <= timer_ticks()) {
+        deadline = timer_ticks() + period;
+    }
+    asm volatile("msr cntp_cval_el0, %0" : : "r"(deadline));
+}
+
+/**
+ * Clear the rings and start sampling
+ * @return 1 on success, 0 if already running or hz is out of range
+ */
+int profile_start(unsigned int hz) {
+    if (running || hz == 0 || hz > PROFILE_MAX_HZ || irq_timer_busy()) {
+        return 0;
+    }
+
+    for (int core = 0; core < PROFILE_CORES; core++) {
+        rings[core].used = 0;
+        rings[core].samples = 0;
+        rings[core].dropped = 0;
+    }
+    rate = hz;
+    period = timer_frequency() / hz;
+
+    irq_set_timer_handler(profile_tick);
+    asm volatile("msr cntp_cval_el0, %0" : : "r"(timer_ticks() + period));
+    asm volatile("msr cntp_ctl_el0, %0; isb" : : "r"((uint64_t)CNTP_CTL_ENABLE));
+    running = 1;
+    return 1;
+}
+
+void profile_stop() {
+    if (!running) {
+        return; // The timer interrupt may belong to someone else
+    }
+    asm volatile("msr cntp_ctl_el0, xzr; isb");
+    irq_set_timer_handler(NULL);
+    running = 0;
+}
+
+int profile_running() {
+    return running;
+}
+
+/**
+ * Whether two samples of the table's ring match: same leaf PC, or same stack
+ */
+static int profile_same(uint32_t a, uint32_t b, int leaf_only) {
+    const uint64_t *words = table_ring->words;
+
+    if (leaf_only) {
+        return words[a + 1] == words[b + 1];
+    }
+    for (int i = 0; i <= (int)words[a]; i++) {
+        if (words[a + i] != words[b + i]) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * Count the samples of one core's ring per stack, or per leaf PC
+ * @return number of samples counted
+ */
+static uint32_t profile_aggregate(int core, int leaf_only) {
+    const profile_ring *ring = &rings[core];
+    uint32_t used = __atomic_load_n(&ring->used, __ATOMIC_ACQUIRE);
+    uint32_t total = 0;
+
+    for (int i = 0; i < PROFILE_TABLE_SIZE; i++) {
+        table[i].count = 0;
+    }
+    table_ring = ring;
+    untracked = 0;
+
+    for (uint32_t offset = 0; offset < used; offset += 1 + ring->words[offset], total++) {
+        // FNV-1a over the PCs (the leaf only, or all of them)
+        uint32_t hash = 2166136261u;
+        int depth = leaf_only ? 1 : (int)ring->words[offset];
+        for (int i = 1; i <= depth; i++) {
+            hash = (hash ^ (uint32_t)(ring->words[offset + i] >> 2)) * 16777619u;
+        }
+
+        int probe;
+        unsigned int slot = hash;
+        for (probe = 0; probe < PROFILE_TABLE_SIZE; probe++, slot++) {
+            profile_bucket *bucket = &table[slot & (PROFILE_TABLE_SIZE - 1)];
+            if (bucket->count == 0) {
+                bucket->offset = offset;
+            }
+            if (bucket->count == 0 || profile_same(bucket->offset, offset, leaf_only)) {
+                bucket->count++;
+                break;
+            }
+        }
+        if (probe == PROFILE_TABLE_SIZE) {
+            untracked++;
+        }
+    }
+    return total;
+}
+
+static uint32_t profile_dropped() {
+    uint32_t dropped = 0;
+    for (int core = 0; core < PROFILE_CORES; core++) {
+        dropped += rings[core].dropped;
+    }
+    return dropped;
+}
+
+static uint32_t profile_samples() {
+    uint32_t samples = 0;
+    for (int core = 0; core < PROFILE_CORES; core++) {
+        samples += rings[core].samples;
+    }
+    return samples;
+}
+
+/**
+ * On-target histogram: the PCs with the most samples, named when the image
+ * has a symbol table
+ */
+static void profile_report() {
+    uint32_t total = profile_samples();
+
+    printf("\n%u samples at %u Hz, %u dropped%s\n", total, rate, profile_dropped(), running ? " (running)" : "");
+    if (total == 0) {
+        return;
+    }
+    printf("  samples      %%  core  pc\n");
+
+    for (int core = 0; core < PROFILE_CORES; core++) {
+        if (profile_aggregate(core, 1) == 0) {
+            continue;
+        }
+
+        // Take the largest remaining bucket each time; the table is rebuilt by the next aggregate
+        for (int row = 0; row < PROFILE_TOP; row++) {
+            profile_bucket *best = NULL;
+            for (int i = 0; i < PROFILE_TABLE_SIZE; i++) {
+                if (table[i].count && (!best || table[i].count > best->count)) {
+                    best = &table[i];
+                }
+            }
+            if (!best) {
+                break;
+            }
+
+            uint64_t pc = table_ring->words[best->offset + 1], offset;
+            const char *name = ksyms_lookup(pc, &offset);
+            printf("%9u %6.2f  %4d  %lx", best->count, 100.0 * best->count / total, core, pc);
+            if (name) {
+                printf(" %s+0x%lx", name, offset);
+            }
+            printf("\n");
+            best->count = 0;
+        }
+    }
+    if (!ksyms_available()) {
+        printf("Symbolize with tools/profsym.py (profile dump)\n");
+    }
+}
+
+/**
+ * Samples per core and call stack for tools/profsym.py:
+ *   profile hz=<rate> samples=<n> dropped=<n> depth=<max stack depth>
+ *   <core> <count> <pc hex> [<caller pc hex> ...]     (one line per stack)
+ *   end
+ */
+static void profile_dump() {
+    printf("\nprofile hz=%u samples=%u dropped=%u depth=%d\n", rate, profile_samples(), profile_dropped(),
+           PROFILE_DEPTH);
+    for (int core = 0; core < PROFILE_CORES; core++) {
+        if (profile_aggregate(core, 0) == 0) {
+            continue;
+        }
+        for (int i = 0; i < PROFILE_TABLE_SIZE; i++) {
+            if (table[i].count) {
+                const uint64_t *sample = &table_ring->words[table[i].offset];
+                printf("%d %u", core, table[i].count);
+                for (int depth = 1; depth <= (int)sample[0]; depth++) {
+                    printf(" %lx", sample[depth]);
+                }
+                printf("\n");
+            }
+        }
+        if (untracked) {
+            printf("%d %u 0\n", core, untracked);
+        }
+    }
+    printf("end\n");
+}
+
+static const char *const *completeProfile(int arg, char **argv) {
+    static const char *const actions[] = {"dump", "report", "start", "stop", NULL};
+    return arg == 1 ? actions : NULL;
+}
+
+static int cmdProfile(int argc, char **argv) {
+    if (strcmp(argv[1], "start") == 0) {
+        unsigned long hz = PROFILE_DEFAULT_HZ;
+        if (argc == 3 && (!parse_number(argv[2], &hz) || hz > PROFILE_MAX_HZ)) {
+            hz = 0; // Rejected below
+        }
+        if (running) {
+            printf("\nThe profiler is already running\n");
+            return CMD_ERR_FAILED;
+        }
+        if (irq_timer_busy()) {
+            printf("\nThe timer interrupt is in use by another command\n");
+            return CMD_ERR_UNAVAILABLE;
+        }
+        if (!profile_start(hz)) {
+            printf("\nRate must be between 1 and %d Hz\n", PROFILE_MAX_HZ);
+            return CMD_ERR_INVALID;
+        }
+        return CMD_OK;
+    }
+    if (argc == 2 && strcmp(argv[1], "stop") == 0) {
+        profile_stop();
+        return CMD_OK;
+    }
+    if (argc == 2 && strcmp(argv[1], "report") == 0) {
+        profile_report();
+        return CMD_OK;
+    }
+    if (argc == 2 && strcmp(argv[1], "dump") == 0) {
+        profile_dump();
+        return CMD_OK;
+    }
+    printf("\nUsage: profile start [hz] | stop | report | dump\n");
+    return CMD_ERR_USAGE;
+}
+REGISTER_COMMAND_COMPLETE("profile", cmdProfile, completeProfile, 1, 2, "start [hz] | stop | report | dump",
+                          "Sample where the kernel spends time.",
+                          "profile start samples the interrupted PC from a timer interrupt (997 Hz by default) "
+                          "until profile stop. profile report lists the busiest addresses; profile dump prints "
+                          "every sample count for tools/profsym.py, which names the functions and writes "
+                          "flame graph input. Example: profile start 2000");
@@ -0,0 +1,35 @@
+// -----------------------------------profile.h -------------------------------------
+#ifndef PROFILE_H
+#define PROFILE_H
+
+/* Sampling profiler.
+ * While running, the EL1 physical timer interrupts every 1/hz seconds and
+ * the handler appends the interrupted call stack (just the PC unless the
+ * kernel is built with FRAME_POINTERS=1, see unwind.h) to the running
+ * core's ring. Each ring has one writer (that core's interrupt handler) and
+ * is only read behind its published length, so no lock is needed; a full
+ * ring counts drops instead of overwriting. Only core 0 runs and takes the
+ * timer interrupt (irq.c), so there is one ring; raise PROFILE_CORES along
+ * with the routing when the other cores are started. 'profile dump' aggregates
+ * identical stacks for tools/profsym.py, which symbolizes them against
+ * build/kernel8.elf. */
+
+#define PROFILE_CORES 1
+#define PROFILE_RING_WORDS 16384  // Per core; a sample takes 1 + depth words
+#define PROFILE_DEFAULT_HZ 997    // Prime, so periodic work is not sampled in phase
+#define PROFILE_MAX_HZ 20000
+#define PROFILE_TABLE_SIZE 1024   // Distinct stacks per core in a dump (power of two)
+#define PROFILE_TOP 15            // Rows in the on-target report
+
+#ifdef FRAME_POINTERS
+#define PROFILE_DEPTH 8
+#else
+#define PROFILE_DEPTH 1
+#endif
+
+/* Function prototypes */
+int profile_start(unsigned int hz);
+void profile_stop();
+int profile_running();
+
+#endif
@@ -0,0 +1,261 @@
+#include "screen.h"
+#include "printf.h"
+
+#define SCREEN_FORMAT_SIZE 10000 // printFormatted() may fill as much as printf's buffer
+#define SCREEN_GAP_RESEND 4      // Re-send up to this many unchanged cells instead of moving
+
+typedef struct {
+    char c;
+    unsigned char attr;
+} screen_cell;
+
+static screen_cell back[SCREEN_ROWS][SCREEN_COLS];  // Being drawn
+static screen_cell front[SCREEN_ROWS][SCREEN_COLS]; // What the terminal shows
+static int front_valid = 0;
+
+// Terminal state as of the last byte sent; -1 when unknown
+static int cursor_row = -1, cursor_col = -1;
+static int current_attr = -1;
+
+static char output[SCREEN_OUTPUT_SIZE + 1];
+static int output_length = 0;
+static int output_total = 0;
+
+/**
+ * Pass the batched bytes on to the printf output sink
+ */
+static void output_flush() {
+    if (output_length) {
+        output[output_length] = '\0';
+        getOutputSink()(output);
+        output_length = 0;
+    }
+}
+
+static void output_char(char c) {
+    if (output_length == SCREEN_OUTPUT_SIZE) {
+        output_flush();
+    }
+    output[output_length++] = c;
+    output_total++;
+}
+
+static void output_string(const char *s) {
+    while (*s) {
+        output_char(*s++);
+    }
+}
+
+static void output_decimal(int n) {
+    char digits[12];
+    int count = 0;
+
+    do {
+        digits[count++] = '0' + n % 10;
+        n /= 10;
+    } while (n);
+    while (count) {
+        output_char(digits[--count]);
+    }
+}
+
+/**
+ * Switch the terminal to an attribute, sending only the parts that change
+ */
+static void set_attr(unsigned char attr) {
+    int fg = attr & 0x07, bg = (attr >> 4) & 0x07;
+
+    if (attr == current_attr) {
+        return;
+    }
+
+    output_string("\033[");
+    if (current_attr < 0 || ((current_attr & SCREEN_BOLD) && !(attr & SCREEN_BOLD))) {
+        // Bold can only be turned off by a reset, which also drops the colors
+        output_string(attr & SCREEN_BOLD ? "0;1;3" : "0;3");
+        output_decimal(fg);
+        output_string(";4");
+        output_decimal(bg);
+    } else {
+        const char *separator = "";
+        if (!(current_attr & SCREEN_BOLD) && (attr & SCREEN_BOLD)) {
+            output_string("1");
+            separator = ";";
+        }
+        if (fg != (current_attr & 0x07)) {
+            output_string(separator);
+            output_char('3');
+            output_decimal(fg);
+            separator = ";";
+        }
+        if (bg != ((current_attr >> 4) & 0x07)) {
+            output_string(separator);
+            output_char('4');
+            output_decimal(bg);
+        }
+    }
+    output_char('m');
+    current_attr = attr;
+}
+
+/**
+ * Move the terminal cursor, re-sending a few unchanged cells when that is
+ * shorter than an escape sequence
+ */
+static void move_to(int row, int col) {
+    if (row == cursor_row && col == cursor_col) {
+        return;
+    }
+
+    if (row == cursor_row && col > cursor_col && col - cursor_col <= SCREEN_GAP_RESEND) {
+        int resend = 1;
+        for (int c = cursor_col; c < col; c++) {
+            if (front[row][c].attr != current_attr) {
+                resend = 0;
+            }
+        }
+        if (resend) {
+            for (int c = cursor_col; c < col; c++) {
+                output_char(front[row][c].c);
+            }
+            cursor_col = col;
+            return;
+        }
+    }
+
+    if (row == cursor_row && col > cursor_col) {
+        output_string("\033[");
+        output_decimal(col - cursor_col);
+        output_char('C');
+    } else {
+        output_string("\033[");
+        output_decimal(row + 1);
+        output_char(';');
+        output_decimal(col + 1);
+        output_char('H');
+    }
+    cursor_row = row;
+    cursor_col = col;
+}
+
+/**
+ * Take over the terminal: hide the cursor and repaint on the next flush
+ */
+void screen_open() {
+    output_string("\033[?25l");
+    screen_invalidate();
+    screen_erase();
+}
+
+/**
+ * Hand the terminal back to the CLI below the last row, in the CLI's colors
+ */
+void screen_close() {
+    output_string("\033[0;1;37m\033[40m\033[");
+    output_decimal(SCREEN_ROWS);
+    output_string(";1H\n\033[?25h");
+    output_flush();
+    screen_invalidate();
+}
+
+/**
+ * Forget what the terminal shows, e.g. after other output
+ */
+void screen_invalidate() {
+    front_valid = 0;
+    cursor_row = cursor_col = -1;
+    current_attr = -1;
+}
+
+/**
+ * Blank the drawing grid
+ */
+void screen_erase() {
+    for (int row = 0; row < SCREEN_ROWS; row++) {
+        screen_fill(row, 0, SCREEN_COLS, ' ', SCREEN_NORMAL);
+    }
+}
+
+/**
+ * Draw width copies of c, clipped to the screen
+ */
+void screen_fill(int row, int col, int width, char c, unsigned char attr) {
+    if (row < 0 || row >= SCREEN_ROWS) {
+        return;
+    }
+    for (; width > 0 && col < SCREEN_COLS; width--, col++) {
+        if (col >= 0) {
+            back[row][col].c = c;
+            back[row][col].attr = attr;
+        }
+    }
+}
+
+/**
+ * Draw text on one row, clipped to the screen
+ * @return the column after the text
+ */
+int screen_puts(int row, int col, unsigned char attr, const char *text) {
+    for (; *text; text++, col++) {
+        screen_fill(row, col, 1, *text == '\n' ? ' ' : *text, attr);
+    }
+    return col;
+}
+
+/**
+ * printf() into the grid
+ * @return the column after the text
+ */
+int screen_printf(int row, int col, unsigned char attr, char *format, ...) {
+    char text[SCREEN_FORMAT_SIZE];
+    va_list args;
+
+    va_start(args, format);
+    printFormatted(text, format, args);
+    va_end(args);
+
+    return screen_puts(row, col, attr, text);
+}
+
+/**
+ * Bring the terminal up to date with the grid
+ * @return number of bytes sent
+ */
+int screen_flush() {
+    output_total = 0;
+
+    if (!front_valid) {
+        set_attr(SCREEN_NORMAL);
+        output_string("\033[2J");
+        for (int row = 0; row < SCREEN_ROWS; row++) {
+            for (int col = 0; col < SCREEN_COLS; col++) {
+                front[row][col].c = ' ';
+                front[row][col].attr = SCREEN_NORMAL;
+            }
+        }
+        front_valid = 1;
+    }
+
+    for (int row = 0; row < SCREEN_ROWS; row++) {
+        for (int col = 0; col < SCREEN_COLS; col++) {
+            screen_cell *want = &back[row][col], *have = &front[row][col];
+            if (want->c == have->c && want->attr == have->attr) {
+                continue;
+            }
+
+            move_to(row, col);
+            set_attr(want->attr);
+            output_char(want->c);
+            *have = *want;
+
+            // The cursor stays on the last column until the next character wraps it
+            cursor_col = col + 1 < SCREEN_COLS ? col + 1 : -1;
+            if (cursor_col < 0) {
+                cursor_row = -1;
+            }
+        }
+    }
+
+    output_flush();
+    return output_total;
+}
@@ -0,0 +1,56 @@
+// -----------------------------------screen.h -------------------------------------
+#ifndef SCREEN_H
+#define SCREEN_H
+
+/* Full-screen output over the serial terminal.
+ * Drawing goes into a character/attribute grid; screen_flush() compares it
+ * with what the terminal is known to show and sends only the cells that
+ * differ, with cursor addressing between runs and a color change only where
+ * the attribute changes. A dashboard that redraws everything each frame
+ * therefore costs a few bytes per changed digit instead of a full repaint.
+ *
+ *   screen_open();
+ *   while (...) {
+ *       screen_erase();
+ *       screen_printf(0, 0, SCREEN_TITLE, "uptime %d s", seconds);
+ *       screen_flush();
+ *   }
+ *   screen_close();
+ *
+ * Anything written with plain printf() while the screen is open leaves the
+ * model out of date; call screen_invalidate() so the next flush repaints. */
+
+#define SCREEN_ROWS 24
+#define SCREEN_COLS 80
+#define SCREEN_OUTPUT_SIZE 512 // Escape sequences are batched up to this size
+
+/* Colors, in ANSI order */
+#define SCREEN_BLACK  0
+#define SCREEN_RED    1
+#define SCREEN_GREEN  2
+#define SCREEN_YELLOW 3
+#define SCREEN_BLUE   4
+#define SCREEN_PURPLE 5
+#define SCREEN_CYAN   6
+#define SCREEN_WHITE  7
+
+/* A cell attribute: foreground, background and bold in one byte */
+#define SCREEN_ATTR(fg, bg) ((unsigned char)((fg) | ((bg) << 4)))
+#define SCREEN_BOLD 0x08
+
+#define SCREEN_NORMAL  (SCREEN_ATTR(SCREEN_WHITE, SCREEN_BLACK) | SCREEN_BOLD) // The CLI's colors
+#define SCREEN_TITLE   SCREEN_ATTR(SCREEN_BLACK, SCREEN_CYAN)
+#define SCREEN_LABEL   SCREEN_ATTR(SCREEN_CYAN, SCREEN_BLACK)
+#define SCREEN_WARNING (SCREEN_ATTR(SCREEN_RED, SCREEN_BLACK) | SCREEN_BOLD)
+
+/* Function prototypes */
+void screen_open();
+void screen_close();
+void screen_invalidate();
+void screen_erase();
+void screen_fill(int row, int col, int width, char c, unsigned char attr);
+int screen_puts(int row, int col, unsigned char attr, const char *text);
+int screen_printf(int row, int col, unsigned char attr, char *format, ...);
+int screen_flush();
+
+#endif
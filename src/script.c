@@ -0,0 +1,702 @@
+#include "script.h"
+#include "cli.h"
+#include "command.h"
+#include "machine.h"
+#include "semihost.h"
+#include "job.h"
+
+// Scripts linked into the image by scripts.S, terminated by a NULL name
+typedef struct {
+    const char *name;
+    const char *start;
+    const char *end;
+} embedded_script;
+
+extern const embedded_script embedded_scripts[];
+
+// Scripts received over the serial line
+static struct {
+    char name[SCRIPT_NAME_SIZE];
+    char text[SCRIPT_MAX_SIZE];
+    int size;
+} slots[SCRIPT_SLOTS];
+
+// Variables, shared by every script and the set command
+static struct {
+    char name[SCRIPT_NAME_SIZE];
+    char value[SCRIPT_VALUE_SIZE];
+} vars[SCRIPT_MAX_VARS];
+
+// State of one running script
+typedef struct {
+    const char *name;
+    char *lines[SCRIPT_MAX_LINES];
+    short jump[SCRIPT_MAX_LINES]; // if -> else/end, else -> end, loop -> end, end -> opener
+    int count;
+    int argc;
+    char **argv;
+    int status; // $?
+} script_state;
+
+// Text and parse state of each running script, kept off the stack: a
+// background job has only JOB_STACK_SIZE, and scripts nest
+static struct {
+    int used;
+    char text[SCRIPT_MAX_SIZE];
+    script_state state;
+} frames[SCRIPT_MAX_DEPTH];
+
+/**
+ * Parse a decimal number with optional sign
+ * @return 1 if the whole string is a number
+ */
+static int script_number(const char *s, int *value) {
+    int negative = (*s == '-');
+    int result = 0;
+
+    if (negative) {
+        s++;
+    }
+    if (!*s) {
+        return 0;
+    }
+    for (; *s; s++) {
+        if (*s < '0' || *s > '9') {
+            return 0;
+        }
+        result = result * 10 + (*s - '0');
+    }
+    *value = negative ? -result : result;
+    return 1;
+}
+
+/**
+ * Write a number in decimal; returns the number of characters
+ */
+static int script_format(int value, char *out, int size) {
+    char digits[12];
+    int n = 0, length = 0;
+    unsigned int magnitude = value < 0 ? -value : value;
+
+    do {
+        digits[n++] = '0' + magnitude % 10;
+        magnitude /= 10;
+    } while (magnitude);
+    if (value < 0 && length < size - 1) {
+        out[length++] = '-';
+    }
+    while (n > 0 && length < size - 1) {
+        out[length++] = digits[--n];
+    }
+    out[length] = '\0';
+    return length;
+}
+
+const char *script_get_var(const char *name) {
+    for (int i = 0; i < SCRIPT_MAX_VARS; i++) {
+        if (vars[i].name[0] && strcmp(vars[i].name, name) == 0) {
+            return vars[i].value;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Set a variable, or delete it when value is NULL
+ * @return 0 if the variable table is full
+ */
+int script_set_var(const char *name, const char *value) {
+    int free = -1;
+
+    for (int i = 0; i < SCRIPT_MAX_VARS; i++) {
+        if (vars[i].name[0] && strcmp(vars[i].name, name) == 0) {
+            free = i;
+            break;
+        }
+        if (!vars[i].name[0] && free < 0) {
+            free = i;
+        }
+    }
+    if (free < 0) {
+        return value == NULL;
+    }
+
+    if (value == NULL) {
+        vars[free].name[0] = '\0';
+        return 1;
+    }
+    strncpy(vars[free].name, name, SCRIPT_NAME_SIZE - 1);
+    vars[free].name[SCRIPT_NAME_SIZE - 1] = '\0';
+    strncpy(vars[free].value, value, SCRIPT_VALUE_SIZE - 1);
+    vars[free].value[SCRIPT_VALUE_SIZE - 1] = '\0';
+    return 1;
+}
+
+/**
+ * Copy a line into out with $ references replaced
+ */
+static void script_expand(script_state *state, const char *line, char *out) {
+    int n = 0;
+
+    while (*line && n < SCRIPT_LINE_SIZE - 1) {
+        if (*line != '$') {
+            out[n++] = *line++;
+            continue;
+        }
+        line++;
+
+        char number[12];
+        const char *value = "";
+        if (*line == '$') {
+            value = "$";
+            line++;
+        } else if (*line == '?') {
+            script_format(state->status, number, sizeof(number));
+            value = number;
+            line++;
+        } else if (*line == '#') {
+            script_format(state->argc > 0 ? state->argc - 1 : 0, number, sizeof(number));
+            value = number;
+            line++;
+        } else if (*line >= '1' && *line <= '9') {
+            int index = *line++ - '0';
+            value = index < state->argc ? state->argv[index] : "";
+        } else {
+            char name[SCRIPT_NAME_SIZE];
+            int length = 0;
+            while ((*line >= 'A' && *line <= 'Z') || (*line >= 'a' && *line <= 'z') ||
+                   (*line >= '0' && *line <= '9') || *line == '_') {
+                if (length < SCRIPT_NAME_SIZE - 1) {
+                    name[length++] = *line;
+                }
+                line++;
+            }
+            name[length] = '\0';
+            if (length == 0) {
+                value = "$";
+            } else if (script_get_var(name)) {
+                value = script_get_var(name);
+            }
+        }
+
+        while (*value && n < SCRIPT_LINE_SIZE - 1) {
+            out[n++] = *value++;
+        }
+    }
+    out[n] = '\0';
+}
+
+/**
+ * First word of a line is a block keyword?
+ */
+static int script_keyword(const char *line, const char *keyword) {
+    int n = strlen(keyword);
+    return strncmp(line, keyword, n) == 0 && (line[n] == '\0' || line[n] == ' ' || line[n] == '\t');
+}
+
+/**
+ * Evaluate the condition of an if statement
+ * @return 1 true, 0 false, -1 malformed
+ */
+static int script_condition(int argc, char **argv) {
+    if (argc == 1) {
+        return argv[0][0] != '\0' && strcmp(argv[0], "0") != 0;
+    }
+    if (argc != 3) {
+        return -1;
+    }
+
+    int a, b, order;
+    if (script_number(argv[0], &a) && script_number(argv[2], &b)) {
+        order = (a > b) - (a < b);
+    } else {
+        order = strcmp(argv[0], argv[2]);
+    }
+
+    const char *op = argv[1];
+    if (strcmp(op, "==") == 0) return order == 0;
+    if (strcmp(op, "!=") == 0) return order != 0;
+    if (strcmp(op, "<") == 0)  return order < 0;
+    if (strcmp(op, ">") == 0)  return order > 0;
+    if (strcmp(op, "<=") == 0) return order <= 0;
+    if (strcmp(op, ">=") == 0) return order >= 0;
+    return -1;
+}
+
+static int script_error(script_state *state, int line, const char *message) {
+    printf("\n%s:%d: %s\n", state->name, line + 1, message);
+    return CMD_ERR_FAILED;
+}
+
+/**
+ * Split the text into lines and pair up if/else/loop with their end
+ */
+static int script_prepare(script_state *state, char *text) {
+    int open[SCRIPT_MAX_NESTING];
+    int nesting = 0;
+
+    state->count = 0;
+    while (*text) {
+        if (state->count == SCRIPT_MAX_LINES) {
+            return script_error(state, state->count, "too many lines");
+        }
+
+        // Leading blanks are dropped, CR/LF become the terminator
+        while (*text == ' ' || *text == '\t') {
+            text++;
+        }
+        int line = state->count++;
+        state->lines[line] = text;
+        while (*text && *text != '\n' && *text != '\r') {
+            text++;
+        }
+        if (*text == '\r') {
+            *text++ = '\0';
+        }
+        if (*text == '\n') {
+            *text++ = '\0';
+        }
+
+        const char *l = state->lines[line];
+        if (script_keyword(l, "if") || script_keyword(l, "loop")) {
+            if (nesting == SCRIPT_MAX_NESTING) {
+                return script_error(state, line, "blocks nested too deeply");
+            }
+            open[nesting++] = line;
+            state->jump[line] = -1;
+        } else if (script_keyword(l, "else")) {
+            if (nesting == 0 || !script_keyword(state->lines[open[nesting - 1]], "if") ||
+                state->jump[open[nesting - 1]] >= 0) {
+                return script_error(state, line, "else without if");
+            }
+            state->jump[open[nesting - 1]] = line;
+            open[nesting - 1] = line; // The matching end now closes the else
+        } else if (script_keyword(l, "end")) {
+            if (nesting == 0) {
+                return script_error(state, line, "end without if or loop");
+            }
+            int opener = open[--nesting];
+            state->jump[opener] = line;
+            // end jumps back to the if or loop, not to an else
+            if (script_keyword(state->lines[opener], "else")) {
+                for (int i = opener - 1; i >= 0; i--) {
+                    if (state->jump[i] == opener && script_keyword(state->lines[i], "if")) {
+                        opener = i;
+                        break;
+                    }
+                }
+            }
+            state->jump[line] = opener;
+        }
+    }
+
+    if (nesting > 0) {
+        return script_error(state, open[nesting - 1], "missing end");
+    }
+    return CMD_OK;
+}
+
+/**
+ * Run prepared lines
+ * @return the status of the last command, or the exit status
+ */
+static int script_execute(script_state *state) {
+    // Active loops: opener line, iteration, count
+    int loop_line[SCRIPT_MAX_NESTING], loop_iteration[SCRIPT_MAX_NESTING], loop_count[SCRIPT_MAX_NESTING];
+    int loops = 0;
+    char expanded[SCRIPT_LINE_SIZE];
+    char words[SCRIPT_LINE_SIZE];
+    char *argv[CMD_MAX_ARGS];
+
+    int pc = 0;
+    while (pc < state->count) {
+        if (job_poll()) {
+            return CMD_ERR_CANCELLED;
+        }
+
+        const char *line = state->lines[pc];
+        if (line[0] == '\0' || line[0] == '#') {
+            pc++;
+            continue;
+        }
+
+        script_expand(state, line, expanded);
+
+        // Split a copy for keywords; commands get the expanded line as typed
+        int argc = 0;
+        char *saveptr;
+        strncpy(words, expanded, SCRIPT_LINE_SIZE);
+        for (char *token = strtok_r(words, " \t", &saveptr); token != NULL && argc < CMD_MAX_ARGS;
+             token = strtok_r(NULL, " \t", &saveptr)) {
+            argv[argc++] = token;
+        }
+        if (argc == 0) {
+            pc++;
+            continue;
+        }
+
+        if (strcmp(argv[0], "if") == 0) {
+            int result = script_condition(argc - 1, argv + 1);
+            if (result < 0) {
+                return script_error(state, pc, "usage: if <a> [<op> <b>]");
+            }
+            pc = result ? pc + 1 : state->jump[pc] + 1;
+        } else if (strcmp(argv[0], "else") == 0) {
+            pc = state->jump[pc] + 1; // End of the taken if branch
+        } else if (strcmp(argv[0], "loop") == 0) {
+            int count;
+            if (argc < 2 || argc > 3 || !script_number(argv[1], &count)) {
+                return script_error(state, pc, "usage: loop <count> [var]");
+            }
+            if (count <= 0) {
+                pc = state->jump[pc] + 1;
+                continue;
+            }
+            loop_line[loops] = pc;
+            loop_iteration[loops] = 0;
+            loop_count[loops] = count;
+            loops++;
+            if (argc == 3) {
+                script_set_var(argv[2], "0");
+            }
+            pc++;
+        } else if (strcmp(argv[0], "end") == 0) {
+            int opener = state->jump[pc];
+            if (loops > 0 && loop_line[loops - 1] == opener) {
+                int top = loops - 1;
+                if (++loop_iteration[top] < loop_count[top]) {
+                    // Update the loop variable, named on the loop line
+                    char loopLine[SCRIPT_LINE_SIZE];
+                    char *loopArgv[4];
+                    int loopArgc = 0;
+                    strncpy(loopLine, state->lines[opener], SCRIPT_LINE_SIZE - 1);
+                    loopLine[SCRIPT_LINE_SIZE - 1] = '\0';
+                    for (char *token = strtok_r(loopLine, " \t", &saveptr); token != NULL && loopArgc < 4;
+                         token = strtok_r(NULL, " \t", &saveptr)) {
+                        loopArgv[loopArgc++] = token;
+                    }
+                    if (loopArgc == 3) {
+                        char number[12];
+                        script_format(loop_iteration[top], number, sizeof(number));
+                        script_set_var(loopArgv[2], number);
+                    }
+                    pc = opener + 1;
+                    continue;
+                }
+                loops--;
+            }
+            pc++;
+        } else if (strcmp(argv[0], "exit") == 0) {
+            int status = state->status;
+            if (argc > 1 && !script_number(argv[1], &status)) {
+                return script_error(state, pc, "usage: exit [status]");
+            }
+            return status;
+        } else {
+            state->status = processCommand(expanded);
+            pc++;
+        }
+    }
+    return state->status;
+}
+
+/**
+ * Copy a script's text into buffer (NUL-terminated)
+ * @return the length, or -1 if there is no such script
+ */
+static int script_load(const char *name, char *buffer) {
+    // Host file through semihosting
+    if (strncmp(name, "host:", 5) == 0) {
+        int fd = semihost_open(name + 5, SEMIHOST_MODE_READ);
+        if (fd < 0) {
+            return -1;
+        }
+        long length = semihost_read(fd, buffer, SCRIPT_MAX_SIZE - 1);
+        semihost_close(fd);
+        if (length < 0) {
+            return -1;
+        }
+        buffer[length] = '\0';
+        return length;
+    }
+
+    for (int i = 0; i < SCRIPT_SLOTS; i++) {
+        if (slots[i].name[0] && strcmp(slots[i].name, name) == 0) {
+            strncpy(buffer, slots[i].text, SCRIPT_MAX_SIZE);
+            buffer[slots[i].size] = '\0';
+            return slots[i].size;
+        }
+    }
+
+    for (const embedded_script *script = embedded_scripts; script->name; script++) {
+        if (strcmp(script->name, name) == 0) {
+            int length = script->end - script->start;
+            if (length > SCRIPT_MAX_SIZE - 1) {
+                length = SCRIPT_MAX_SIZE - 1;
+            }
+            for (int i = 0; i < length; i++) {
+                buffer[i] = script->start[i];
+            }
+            buffer[length] = '\0';
+            return length;
+        }
+    }
+    return -1;
+}
+
+/**
+ * A free frame; scripts in background jobs do not finish in nesting order
+ * @return its index, or -1 (with a message) if every frame is in use
+ */
+static int script_frame() {
+    for (int frame = 0; frame < SCRIPT_MAX_DEPTH; frame++) {
+        if (!frames[frame].used) {
+            return frame;
+        }
+    }
+    printf("\nScripts nested too deeply\n");
+    return -1;
+}
+
+/**
+ * Run a script by name; argv[1..] become $1..$9
+ * @return the script's status
+ */
+int script_run(const char *name, int argc, char **argv) {
+    int frame = script_frame();
+    if (frame < 0) {
+        return CMD_ERR_FAILED;
+    }
+
+    char *text = frames[frame].text;
+    script_state *state = &frames[frame].state;
+    if (script_load(name, text) < 0) {
+        printf("\nNo script named %s\n", name);
+        return CMD_ERR_INVALID;
+    }
+
+    frames[frame].used = 1;
+    state->name = name;
+    state->argc = argc;
+    state->argv = argv;
+    state->status = CMD_OK;
+    int status = script_prepare(state, text);
+    if (status == CMD_OK) {
+        status = script_execute(state);
+    }
+    frames[frame].used = 0;
+    return status;
+}
+
+/**
+ * Receive a script over the serial line into a RAM slot; the text ends
+ * with a line holding only ".". Input goes through job_getc(), so background
+ * jobs keep running and Ctrl-C abandons the upload; for that reason it only
+ * runs in the foreground.
+ * @return CMD_OK, or an error status
+ */
+int script_receive(const char *name) {
+    int slot = -1;
+
+    if (job_is_background()) {
+        printf("\nscript load reads the console and cannot run as a background job\n");
+        return CMD_ERR_UNAVAILABLE;
+    }
+
+    for (int i = 0; i < SCRIPT_SLOTS; i++) {
+        if (slots[i].name[0] && strcmp(slots[i].name, name) == 0) {
+            slot = i;
+            break;
+        }
+        if (!slots[i].name[0] && slot < 0) {
+            slot = i;
+        }
+    }
+    if (slot < 0) {
+        printf("\nAll %d script slots are in use\n", SCRIPT_SLOTS);
+        return CMD_ERR_FAILED;
+    }
+
+    if (!machine_mode()) {
+        printf("\nSend the script, ending with a line containing only '.'\n");
+    }
+
+    char *text = slots[slot].text;
+    int size = 0, line_start = 0, overflow = 0;
+    while (1) {
+        char c = job_getc();
+        if (c == KEY_INTERRUPT) {
+            // The slot's old text is partly overwritten
+            slots[slot].name[0] = '\0';
+            printf("\nUpload cancelled\n");
+            return CMD_ERR_CANCELLED;
+        }
+        if (!machine_mode()) {
+            uart_sendc(c);
+        }
+        if (c != '\n') {
+            if (size < SCRIPT_MAX_SIZE - 1) {
+                text[size++] = c;
+            } else {
+                overflow = 1;
+            }
+            continue;
+        }
+
+        // End marker: drop the "." line
+        if (size - line_start == 1 && text[line_start] == '.') {
+            size = line_start;
+            break;
+        }
+        if (size < SCRIPT_MAX_SIZE - 1) {
+            text[size++] = '\n';
+        } else {
+            overflow = 1;
+        }
+        line_start = size;
+    }
+    text[size] = '\0';
+
+    if (overflow) {
+        slots[slot].name[0] = '\0';
+        printf("\nScript longer than %d bytes\n", SCRIPT_MAX_SIZE - 1);
+        return CMD_ERR_FAILED;
+    }
+    strncpy(slots[slot].name, name, SCRIPT_NAME_SIZE - 1);
+    slots[slot].name[SCRIPT_NAME_SIZE - 1] = '\0';
+    slots[slot].size = size;
+    printf("\nStored %s (%d bytes)\n", slots[slot].name, size);
+    return CMD_OK;
+}
+
+/**
+ * Run the embedded "autorun" script, if the image has one
+ */
+void script_autorun() {
+    for (const embedded_script *script = embedded_scripts; script->name; script++) {
+        if (strcmp(script->name, "autorun") == 0) {
+            char *argv[1] = {"autorun"};
+            script_run("autorun", 1, argv);
+            return;
+        }
+    }
+}
+
+static const char *const *completeRun(int arg, char **argv) {
+    // Embedded names only: the completion trie is cached, and they never change
+    static const char *names[SCRIPT_MAX_EMBEDDED + 1];
+
+    if (arg != 1) {
+        return NULL;
+    }
+    if (!names[0]) {
+        int n = 0;
+        for (const embedded_script *script = embedded_scripts; script->name && n < SCRIPT_MAX_EMBEDDED; script++) {
+            names[n++] = script->name;
+        }
+        names[n] = NULL;
+    }
+    return names;
+}
+
+static int cmdRun(int argc, char **argv) {
+    return script_run(argv[1], argc - 1, argv + 1);
+}
+REGISTER_COMMAND_COMPLETE("run", cmdRun, completeRun, 1, CMD_MAX_ARGS - 1, "<script> [args]",
+                          "Run a script of CLI commands.",
+                          "Runs a script loaded with 'script load', linked into the image, or read from the host "
+                          "with semihosting (host:<path>). Arguments are $1..$9. Example: run uart-defaults");
+
+static const char *const *completeScript(int arg, char **argv) {
+    static const char *const values[] = {"list", "load", "show", NULL};
+    return arg == 1 ? values : NULL;
+}
+
+static int cmdScript(int argc, char **argv) {
+    if (strcmp(argv[1], "list") == 0 && argc == 2) {
+        printf("\n");
+        for (int i = 0; i < SCRIPT_SLOTS; i++) {
+            if (slots[i].name[0]) {
+                printf("%s (loaded, %d bytes)\n", slots[i].name, slots[i].size);
+            }
+        }
+        for (const embedded_script *script = embedded_scripts; script->name; script++) {
+            printf("%s (embedded, %d bytes)\n", script->name, (int)(script->end - script->start));
+        }
+        return CMD_OK;
+    }
+    if (strcmp(argv[1], "load") == 0 && argc == 3) {
+        return script_receive(argv[2]);
+    }
+    if (strcmp(argv[1], "show") == 0 && argc == 3) {
+        // Borrow a free frame's buffer: nothing here polls, so no script can claim it meanwhile
+        int frame = script_frame();
+        if (frame < 0) {
+            return CMD_ERR_FAILED;
+        }
+        if (script_load(argv[2], frames[frame].text) < 0) {
+            printf("\nNo script named %s\n", argv[2]);
+            return CMD_ERR_INVALID;
+        }
+        printf("\n%s\n", frames[frame].text);
+        return CMD_OK;
+    }
+    printf("\nUsage: script list | script load <name> | script show <name>\n");
+    return CMD_ERR_USAGE;
+}
+REGISTER_COMMAND_COMPLETE("script", cmdScript, completeScript, 1, 2, "list | load <name> | show <name>",
+                          "List, receive or print scripts.",
+                          "script load <name> stores the text sent over the serial line, up to a line holding only '.'. "
+                          "Example: script load setup");
+
+static int cmdSet(int argc, char **argv) {
+    char value[SCRIPT_VALUE_SIZE];
+    int n = 0;
+
+    // No arguments: list the variables
+    if (argc == 1) {
+        printf("\n");
+        for (int i = 0; i < SCRIPT_MAX_VARS; i++) {
+            if (vars[i].name[0]) {
+                printf("%s=%s\n", vars[i].name, vars[i].value);
+            }
+        }
+        return CMD_OK;
+    }
+
+    // set NAME deletes; set NAME words... joins the words with spaces
+    if (argc == 2) {
+        script_set_var(argv[1], NULL);
+        return CMD_OK;
+    }
+    for (int i = 2; i < argc; i++) {
+        for (const char *s = argv[i]; *s && n < SCRIPT_VALUE_SIZE - 1; s++) {
+            value[n++] = *s;
+        }
+        if (i + 1 < argc && n < SCRIPT_VALUE_SIZE - 1) {
+            value[n++] = ' ';
+        }
+    }
+    value[n] = '\0';
+
+    if (!script_set_var(argv[1], value)) {
+        printf("\nNo room for more than %d variables\n", SCRIPT_MAX_VARS);
+        return CMD_ERR_FAILED;
+    }
+    return CMD_OK;
+}
+REGISTER_COMMAND("set", cmdSet, 0, CMD_MAX_ARGS - 1, "[name [value...]]",
+                 "Set, delete or list script variables.",
+                 "set NAME value sets $NAME, set NAME deletes it, set alone lists all. Example: set RATE 115200");
+
+static int cmdEcho(int argc, char **argv) {
+    printf("\n");
+    for (int i = 1; i < argc; i++) {
+        printf("%s%s", argv[i], i + 1 < argc ? " " : "");
+    }
+    printf("\n");
+    return CMD_OK;
+}
+REGISTER_COMMAND("echo", cmdEcho, 0, CMD_MAX_ARGS - 1, "[text...]",
+                 "Print its arguments.",
+                 "Prints its arguments; useful in scripts. Example: echo baud is $RATE");
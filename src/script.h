@@ -0,0 +1,42 @@
+// -----------------------------------script.h -------------------------------------
+#ifndef SCRIPT_H
+#define SCRIPT_H
+
+/* CLI scripts.
+ * A script is plain text, one command per line, run through processCommand.
+ * Scripts come from three places, searched in this order:
+ *   - RAM slots filled over the serial line with "script load <name>"
+ *   - blobs linked into the image from src/scripts/ (see scripts.S)
+ *   - host files via semihosting, named "host:<path>"
+ * The embedded script "autorun", if present, runs at boot.
+ *
+ * Language, one statement per line:
+ *   # comment
+ *   <command> [args]          any CLI command; $? holds its status
+ *   if <a> <op> <b> / if <a>  op is == != < > <= >=, numeric when both sides are numbers;
+ *   else / end                a lone word is true unless empty or 0
+ *   loop <n> [var] / end      run the body n times, var counting from 0
+ *   exit [status]
+ * Before a line runs, $NAME is replaced by the variable (see the set command),
+ * $1..$9 by the run arguments, $# by their count, $? by the last status and
+ * $$ by a dollar sign. */
+
+#define SCRIPT_MAX_SIZE 4096
+#define SCRIPT_MAX_LINES 256
+#define SCRIPT_LINE_SIZE 100  // Same as the CLI's MAX_CMD_SIZE
+#define SCRIPT_SLOTS 4        // Scripts loaded over serial
+#define SCRIPT_NAME_SIZE 16
+#define SCRIPT_MAX_EMBEDDED 16 // Names offered by TAB completion
+#define SCRIPT_MAX_DEPTH 4    // Scripts running at once, nested or in jobs
+#define SCRIPT_MAX_NESTING 8  // Nested if/loop blocks
+#define SCRIPT_MAX_VARS 16
+#define SCRIPT_VALUE_SIZE 64
+
+/* Function prototypes */
+int script_run(const char *name, int argc, char **argv);
+int script_receive(const char *name);
+void script_autorun();
+const char *script_get_var(const char *name);
+int script_set_var(const char *name, const char *value);
+
+#endif
@@ -0,0 +1,117 @@
+#include "semihost.h"
+#include "utility.h"
+
+static int console_fd = -1; // Host stdout, opened on first use
+static int log_fd = -1;     // Host file receiving semihost_file_puts() output
+
+#ifdef SEMIHOSTING
+
+/**
+ * Issue a semihosting request; the result comes back in x0
+ */
+static long semihost_call(unsigned long op, void *args) {
+    register unsigned long x0 asm("x0") = op;
+    register void *x1 asm("x1") = args;
+
+    asm volatile("hlt #0xf000" : "+r"(x0) : "r"(x1) : "memory");
+    return (long)x0;
+}
+
+int semihost_available() {
+    return 1;
+}
+
+#else
+
+static long semihost_call(unsigned long op, void *args) {
+    return -1;
+}
+
+int semihost_available() {
+    return 0;
+}
+
+#endif
+
+/**
+ * Open a host file
+ * @return a host file handle, or -1 on failure
+ */
+int semihost_open(const char *path, int mode) {
+    unsigned long args[3] = {(unsigned long)path, mode, strlen(path)};
+    return semihost_call(SYS_OPEN, args);
+}
+
+int semihost_close(int fd) {
+    unsigned long args[1] = {fd};
+    return semihost_call(SYS_CLOSE, args);
+}
+
+/**
+ * Write a buffer to a host file
+ * @return number of bytes written, or -1 on failure
+ */
+long semihost_write(int fd, const void *buffer, size_t len) {
+    unsigned long args[3] = {fd, (unsigned long)buffer, len};
+    long not_written = semihost_call(SYS_WRITE, args);
+    return not_written < 0 ? -1 : (long)len - not_written;
+}
+
+/**
+ * Read from a host file
+ * @return number of bytes read (0 at end of file), or -1 on failure
+ */
+long semihost_read(int fd, void *buffer, size_t len) {
+    unsigned long args[3] = {fd, (unsigned long)buffer, len};
+    long not_read = semihost_call(SYS_READ, args);
+    return not_read < 0 ? -1 : (long)len - not_read;
+}
+
+/**
+ * Length of a host file in bytes, or -1
+ */
+long semihost_flen(int fd) {
+    unsigned long args[1] = {fd};
+    return semihost_call(SYS_FLEN, args);
+}
+
+/**
+ * Centiseconds since the emulator started, or -1
+ */
+long semihost_clock() {
+    return semihost_call(SYS_CLOCK, 0);
+}
+
+/**
+ * Output sink writing to the host's standard output (":tt")
+ */
+void semihost_console_puts(char *string) {
+    if (console_fd < 0) {
+        console_fd = semihost_open(":tt", SEMIHOST_MODE_WRITE);
+    }
+    semihost_write(console_fd, string, strlen(string));
+}
+
+/**
+ * Output sink writing to the file opened with semihost_log_open()
+ */
+void semihost_file_puts(char *string) {
+    semihost_write(log_fd, string, strlen(string));
+}
+
+/**
+ * Create (or truncate) a host file for semihost_file_puts()
+ * @return 1 on success, 0 on failure
+ */
+int semihost_log_open(const char *path) {
+    semihost_log_close();
+    log_fd = semihost_open(path, SEMIHOST_MODE_WRITE);
+    return log_fd >= 0;
+}
+
+void semihost_log_close() {
+    if (log_fd >= 0) {
+        semihost_close(log_fd);
+        log_fd = -1;
+    }
+}
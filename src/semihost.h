@@ -0,0 +1,40 @@
+// -----------------------------------semihost.h -------------------------------------
+#ifndef SEMIHOST_H
+#define SEMIHOST_H
+
+#include "../gcclib/stddef.h"
+
+/* Arm semihosting: the kernel asks the debugger or emulator (QEMU with
+ * -semihosting) to perform I/O on the host. Requests trap with HLT #0xF000,
+ * which only works when something is there to catch them, so support is
+ * compiled in with "make SEMIHOSTING=1". Without it every call fails and the
+ * output stays on UART0. */
+
+/* Operation numbers */
+#define SYS_OPEN   0x01
+#define SYS_CLOSE  0x02
+#define SYS_WRITE  0x05
+#define SYS_READ   0x06
+#define SYS_FLEN   0x0C
+#define SYS_CLOCK  0x10
+
+/* SYS_OPEN modes (fopen equivalents) */
+#define SEMIHOST_MODE_READ   1 // "rb"
+#define SEMIHOST_MODE_WRITE  5 // "wb"
+#define SEMIHOST_MODE_APPEND 9 // "ab"
+
+/* Function prototypes */
+int semihost_available();
+int semihost_open(const char *path, int mode);
+int semihost_close(int fd);
+long semihost_write(int fd, const void *buffer, size_t len);
+long semihost_read(int fd, void *buffer, size_t len);
+long semihost_flen(int fd);
+long semihost_clock();
+
+void semihost_console_puts(char *string);
+void semihost_file_puts(char *string);
+int semihost_log_open(const char *path);
+void semihost_log_close();
+
+#endif
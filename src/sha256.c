@@ -0,0 +1,231 @@
+#include "sha256.h"
+
+#if defined(__aarch64__)
+#include "../gcclib/arm_neon.h"
+#endif
+
+/* SHA-256 (FIPS 180-4).
+ * The compression function runs on the ARMv8 Cryptography Extension
+ * (SHA256H/SHA256H2/SHA256SU0/SHA256SU1) when ID_AA64ISAR0_EL1 reports it.
+ * The BCM2837 (RPI3) and BCM2711 (RPI4) ship without the extension while QEMU's
+ * Cortex-A53 has it, so the portable implementation is always built too. */
+
+static const uint32_t K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+static const uint32_t H0[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+typedef void (*sha256_blocks_fn)(uint32_t state[8], const uint8_t *data, size_t blocks);
+
+static sha256_blocks_fn sha256_blocks = 0;
+
+#define ROTR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+/**
+ * Portable compression function
+ */
+static void sha256_blocks_sw(uint32_t state[8], const uint8_t *data, size_t blocks) {
+    uint32_t w[64];
+
+    while (blocks--) {
+        for (int i = 0; i < 16; i++) {
+            w[i] = (uint32_t)data[4 * i] << 24 | (uint32_t)data[4 * i + 1] << 16 |
+                   (uint32_t)data[4 * i + 2] << 8 | data[4 * i + 3];
+        }
+        for (int i = 16; i < 64; i++) {
+            uint32_t s0 = ROTR(w[i - 15], 7) ^ ROTR(w[i - 15], 18) ^ (w[i - 15] >> 3);
+            uint32_t s1 = ROTR(w[i - 2], 17) ^ ROTR(w[i - 2], 19) ^ (w[i - 2] >> 10);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+
+        uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+        uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+
+        for (int i = 0; i < 64; i++) {
+            uint32_t t1 = h + (ROTR(e, 6) ^ ROTR(e, 11) ^ ROTR(e, 25)) + ((e & f) ^ (~e & g)) + K[i] + w[i];
+            uint32_t t2 = (ROTR(a, 2) ^ ROTR(a, 13) ^ ROTR(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+            h = g;
+            g = f;
+            f = e;
+            e = d + t1;
+            d = c;
+            c = b;
+            b = a;
+            a = t1 + t2;
+        }
+
+        state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+        state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+        data += SHA256_BLOCK_SIZE;
+    }
+}
+
+#if defined(__aarch64__)
+
+/**
+ * Compression function on the Cryptography Extension, four rounds per
+ * SHA256H/SHA256H2 pair with the message schedule computed alongside
+ */
+__attribute__((target("+crypto")))
+static void sha256_blocks_ce(uint32_t state[8], const uint8_t *data, size_t blocks) {
+    uint32x4_t abcd = vld1q_u32(&state[0]);
+    uint32x4_t efgh = vld1q_u32(&state[4]);
+
+    while (blocks--) {
+        uint32x4_t abcd_saved = abcd, efgh_saved = efgh;
+        uint32x4_t msg[4];
+
+        // Message words are big-endian
+        for (int i = 0; i < 4; i++) {
+            msg[i] = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + 16 * i)));
+        }
+
+#pragma GCC unroll 16
+        for (int i = 0; i < 16; i++) {
+            uint32x4_t wk = vaddq_u32(msg[i & 3], vld1q_u32(&K[4 * i]));
+            uint32x4_t abcd_prev = abcd;
+
+            // W[4i+16..4i+19] replaces W[4i..4i+3] for the later rounds
+            if (i < 12) {
+                msg[i & 3] = vsha256su1q_u32(vsha256su0q_u32(msg[i & 3], msg[(i + 1) & 3]),
+                                             msg[(i + 2) & 3], msg[(i + 3) & 3]);
+            }
+
+            abcd = vsha256hq_u32(abcd, efgh, wk);
+            efgh = vsha256h2q_u32(efgh, abcd_prev, wk);
+        }
+
+        abcd = vaddq_u32(abcd, abcd_saved);
+        efgh = vaddq_u32(efgh, efgh_saved);
+        data += SHA256_BLOCK_SIZE;
+    }
+
+    vst1q_u32(&state[0], abcd);
+    vst1q_u32(&state[4], efgh);
+}
+
+/**
+ * Check ID_AA64ISAR0_EL1.SHA2 for the SHA-256 instructions
+ */
+int sha256_hw_available() {
+    uint64_t isar0;
+    asm volatile("mrs %0, id_aa64isar0_el1" : "=r"(isar0));
+    return ((isar0 >> 12) & 0xF) != 0;
+}
+
+/**
+ * Select the Cryptography Extension (if present) or the portable code
+ */
+void sha256_use_hw(int enable) {
+    sha256_blocks = (enable && sha256_hw_available()) ? sha256_blocks_ce : sha256_blocks_sw;
+}
+
+#else
+
+int sha256_hw_available() {
+    return 0;
+}
+
+void sha256_use_hw(int enable) {
+    sha256_blocks = sha256_blocks_sw;
+}
+
+#endif
+
+/**
+ * Start a new hash
+ */
+void sha256_init(sha256_ctx *ctx) {
+    if (!sha256_blocks) {
+        sha256_use_hw(1);
+    }
+    for (int i = 0; i < 8; i++) {
+        ctx->state[i] = H0[i];
+    }
+    ctx->length = 0;
+    ctx->buffered = 0;
+}
+
+/**
+ * Hash more data; whole blocks go straight to the compression function
+ */
+void sha256_update(sha256_ctx *ctx, const void *data, size_t len) {
+    const uint8_t *p = data;
+
+    ctx->length += len;
+
+    // Complete a previously buffered partial block
+    if (ctx->buffered) {
+        while (len && ctx->buffered < SHA256_BLOCK_SIZE) {
+            ctx->buffer[ctx->buffered++] = *p++;
+            len--;
+        }
+        if (ctx->buffered < SHA256_BLOCK_SIZE) {
+            return;
+        }
+        sha256_blocks(ctx->state, ctx->buffer, 1);
+        ctx->buffered = 0;
+    }
+
+    if (len >= SHA256_BLOCK_SIZE) {
+        sha256_blocks(ctx->state, p, len / SHA256_BLOCK_SIZE);
+        p += len & ~(size_t)(SHA256_BLOCK_SIZE - 1);
+        len &= SHA256_BLOCK_SIZE - 1;
+    }
+
+    while (len--) {
+        ctx->buffer[ctx->buffered++] = *p++;
+    }
+}
+
+/**
+ * Pad the message, finish the hash and write the big-endian digest
+ */
+void sha256_final(sha256_ctx *ctx, uint8_t digest[SHA256_DIGEST_SIZE]) {
+    uint64_t bits = ctx->length * 8;
+
+    // 0x80 terminator, zeros, then the 64-bit message length
+    ctx->buffer[ctx->buffered++] = 0x80;
+    if (ctx->buffered > SHA256_BLOCK_SIZE - 8) {
+        while (ctx->buffered < SHA256_BLOCK_SIZE) {
+            ctx->buffer[ctx->buffered++] = 0;
+        }
+        sha256_blocks(ctx->state, ctx->buffer, 1);
+        ctx->buffered = 0;
+    }
+    while (ctx->buffered < SHA256_BLOCK_SIZE - 8) {
+        ctx->buffer[ctx->buffered++] = 0;
+    }
+    for (int i = 7; i >= 0; i--) {
+        ctx->buffer[ctx->buffered++] = bits >> (8 * i);
+    }
+    sha256_blocks(ctx->state, ctx->buffer, 1);
+
+    for (int i = 0; i < 8; i++) {
+        digest[4 * i] = ctx->state[i] >> 24;
+        digest[4 * i + 1] = ctx->state[i] >> 16;
+        digest[4 * i + 2] = ctx->state[i] >> 8;
+        digest[4 * i + 3] = ctx->state[i];
+    }
+}
+
+/**
+ * One-shot hash of a buffer
+ */
+void sha256(const void *data, size_t len, uint8_t digest[SHA256_DIGEST_SIZE]) {
+    sha256_ctx ctx;
+
+    sha256_init(&ctx);
+    sha256_update(&ctx, data, len);
+    sha256_final(&ctx, digest);
+}
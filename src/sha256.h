@@ -0,0 +1,29 @@
+// -----------------------------------sha256.h -------------------------------------
+#ifndef SHA256_H
+#define SHA256_H
+
+#include "../gcclib/stddef.h"
+#include "gpio.h"
+
+#define SHA256_BLOCK_SIZE 64
+#define SHA256_DIGEST_SIZE 32
+
+/* Streaming SHA-256 state: sha256_init(), any number of sha256_update() calls,
+ * then sha256_final() */
+typedef struct {
+    uint32_t state[8];
+    uint64_t length;                        // Total bytes hashed
+    uint8_t buffer[SHA256_BLOCK_SIZE];      // Partial block waiting for more data
+    unsigned int buffered;
+} sha256_ctx;
+
+/* Function prototypes */
+void sha256_init(sha256_ctx *ctx);
+void sha256_update(sha256_ctx *ctx, const void *data, size_t len);
+void sha256_final(sha256_ctx *ctx, uint8_t digest[SHA256_DIGEST_SIZE]);
+void sha256(const void *data, size_t len, uint8_t digest[SHA256_DIGEST_SIZE]);
+
+int sha256_hw_available();
+void sha256_use_hw(int enable);
+
+#endif
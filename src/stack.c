@@ -0,0 +1,101 @@
+#include "stack.h"
+#include "command.h"
+#include "machine.h"
+#include "utility.h"
+
+// Bottom of the boot stack, which grows down from _start (link.ld)
+extern uint64_t __boot_stack_bottom[];
+
+static stack_region stacks[STACK_MAX];
+static int stack_count = 0;
+
+/**
+ * Fill a stack with paint. It must not be in use.
+ */
+void stack_paint(uint64_t *base, unsigned long size) {
+    for (unsigned long i = 0; i < size / sizeof(uint64_t); i++) {
+        base[i] = STACK_PAINT;
+    }
+}
+
+/**
+ * Paint the unused part of the boot stack and register it; call first
+ * thing in main(), while interrupts are still masked
+ */
+void stack_init() {
+    uint64_t *base = __boot_stack_bottom;
+    uint64_t *sp;
+
+    // Everything below the stack pointer is free: AArch64 has no red zone
+    asm volatile("mov %0, sp" : "=r"(sp));
+    for (uint64_t *word = base; word < sp; word++) {
+        *word = STACK_PAINT;
+    }
+    stack_register("boot", base, STACK_BOOT_SIZE);
+}
+
+/**
+ * Add a stack to the 'stacks' report, or update the entry with the same base
+ */
+void stack_register(const char *name, uint64_t *base, unsigned long size) {
+    int i = 0;
+    while (i < stack_count && stacks[i].base != base) {
+        i++;
+    }
+    if (i == STACK_MAX) {
+        return;
+    }
+    if (i == stack_count) {
+        stack_count++;
+    }
+    stacks[i] = (stack_region){name, base, size};
+}
+
+/**
+ * Deepest use of a painted stack
+ * @return bytes that are no longer paint, counted from the top
+ */
+unsigned long stack_used(const uint64_t *base, unsigned long size) {
+    unsigned long words = size / sizeof(uint64_t), free = 0;
+    while (free < words && base[free] == STACK_PAINT) {
+        free++;
+    }
+    return size - free * sizeof(uint64_t);
+}
+
+/**
+ * Whether the guard words at the bottom of a stack still hold paint
+ */
+int stack_intact(const uint64_t *base) {
+    for (int i = 0; i < STACK_GUARD_BYTES / sizeof(uint64_t); i++) {
+        if (base[i] != STACK_PAINT) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static int cmdStacks(int argc, char **argv) {
+    if (!machine_mode()) {
+        printf("\nStack        Base       Size       Used   Peak   Guard\n");
+    }
+    for (int i = 0; i < stack_count; i++) {
+        const stack_region *stack = &stacks[i];
+        unsigned long used = stack_used(stack->base, stack->size);
+        int intact = stack_intact(stack->base);
+
+        if (machine_mode()) {
+            printf("%s=base:%lx,size:%lu,used:%lu,guard:%s\n", stack->name, (unsigned long)stack->base, stack->size,
+                   used, intact ? "ok" : "overflow");
+        } else {
+            printf("%-8.8s %8lx %10lu %10lu %5.1f%%   %s\n", stack->name, (unsigned long)stack->base, stack->size, used,
+                   100.0 * used / stack->size, intact ? "ok" : "OVERFLOW");
+        }
+    }
+    return CMD_OK;
+}
+REGISTER_COMMAND("stacks", cmdStacks, 0, 0, "",
+                 "Stack high-water marks.",
+                 "Lists every stack (the boot stack the CLI runs on, and the background jobs') with its "
+                 "size and the most of it ever used, found by scanning for the paint written when the stack "
+                 "was created. Guard shows OVERFLOW once the lowest 64 bytes have been written.");
@@ -0,0 +1,40 @@
+// -----------------------------------stack.h -------------------------------------
+#ifndef STACK_H
+#define STACK_H
+
+#include "gpio.h"
+
+/* Stack painting and high-water marks ('stacks').
+ * Each stack is filled with STACK_PAINT when it is created and registered
+ * here; the deepest point it ever reached is then found by scanning up
+ * from its lowest address for the first word that is no longer paint. The
+ * lowest STACK_GUARD_BYTES act as a canary: once they are overwritten the
+ * stack has overflowed (or is about to), which job.c checks every time a
+ * job yields. With the MMU off there are no guard pages, so an overflow is
+ * only detected after the fact.
+ *
+ * The stacks are the boot stack, on which main() and the CLI run, growing
+ * down from _start (0x80000) with a budget of STACK_BOOT_SIZE, and one per
+ * background job. Only core 0 runs, and exceptions are taken on the stack
+ * that was interrupted (an 800-byte frame plus the handler), so they count
+ * towards that stack's mark. */
+
+#define STACK_PAINT 0x5354414b5354414bull // "KATSKATS"
+#define STACK_GUARD_BYTES 64
+#define STACK_BOOT_SIZE 0x20000 // 128 KB below _start; link.ld places __boot_stack_bottom there
+#define STACK_MAX 8
+
+typedef struct {
+    const char *name;
+    uint64_t *base;      // Lowest address
+    unsigned long size;  // Bytes
+} stack_region;
+
+/* Function prototypes */
+void stack_init();
+void stack_paint(uint64_t *base, unsigned long size);
+void stack_register(const char *name, uint64_t *base, unsigned long size);
+unsigned long stack_used(const uint64_t *base, unsigned long size);
+int stack_intact(const uint64_t *base);
+
+#endif
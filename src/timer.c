@@ -0,0 +1,44 @@
+#include "timer.h"
+
+/**
+ * Return the generic timer frequency in Hz
+ */
+uint64_t timer_frequency() {
+    uint64_t freq;
+    asm volatile("mrs %0, cntfrq_el0" : "=r"(freq));
+    return freq;
+}
+
+/**
+ * Convert a number of counter ticks to microseconds
+ */
+uint64_t timer_ticks_to_usec(uint64_t ticks) {
+    uint64_t freq = timer_frequency();
+    // Split the conversion so that ticks * 1000000 cannot overflow
+    return (ticks / freq) * 1000000 + ((ticks % freq) * 1000000) / freq;
+}
+
+/**
+ * Convert microseconds to a number of counter ticks (rounded up)
+ */
+uint64_t timer_usec_to_ticks(uint64_t usec) {
+    uint64_t freq = timer_frequency();
+    return (usec / 1000000) * freq + ((usec % 1000000) * freq + 999999) / 1000000;
+}
+
+/**
+ * Busy-wait for the given number of microseconds
+ */
+void wait_usec(unsigned int usec) {
+    uint64_t deadline = timer_ticks() + timer_usec_to_ticks(usec);
+    while (timer_ticks() < deadline) {
+        asm volatile("nop");
+    }
+}
+
+/**
+ * Busy-wait for the given number of milliseconds
+ */
+void wait_msec(unsigned int msec) {
+    wait_usec(msec * 1000);
+}
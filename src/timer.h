@@ -0,0 +1,25 @@
+// -----------------------------------timer.h -------------------------------------
+#ifndef TIMER_H
+#define TIMER_H
+
+#include "gpio.h"
+
+/* ARM generic timer (CNTPCT_EL0 / CNTFRQ_EL0).
+ * The counter runs at a fixed frequency independent of the CPU clock
+ * (19.2 MHz on RPI3, 54 MHz on RPI4, 62.5 MHz under QEMU). */
+
+/* Read the current physical counter value */
+static inline uint64_t timer_ticks(void) {
+    uint64_t ticks;
+    asm volatile("isb; mrs %0, cntpct_el0" : "=r"(ticks) : : "memory");
+    return ticks;
+}
+
+/* Function prototypes */
+uint64_t timer_frequency();
+uint64_t timer_ticks_to_usec(uint64_t ticks);
+uint64_t timer_usec_to_ticks(uint64_t usec);
+void wait_usec(unsigned int usec);
+void wait_msec(unsigned int msec);
+
+#endif
@@ -0,0 +1,119 @@
+#include "trace.h"
+#include "timer.h"
+#include "command.h"
+#include "utility.h"
+
+#ifdef TRACE
+
+typedef struct {
+    trace_record records[TRACE_RECORDS];
+    uint32_t next; // Total records written; the ring index is next % TRACE_RECORDS
+} trace_ring;
+
+static trace_ring rings[TRACE_CORES];
+static volatile int enabled = 1; // Recording from boot until 'trace stop'
+
+/**
+ * Append one record to the running core's ring. Interrupts are masked for
+ * the few instructions this takes, so an interrupt handler's own records
+ * cannot claim the same slot.
+ */
+static inline NO_TRACE void trace_record_event(void *function, uint32_t kind) {
+    uint64_t daif, mpidr, time;
+
+    if (!enabled) {
+        return;
+    }
+    asm volatile("mrs %0, daif; msr daifset, #2" : "=r"(daif) : : "memory");
+    asm volatile("mrs %0, mpidr_el1" : "=r"(mpidr));
+    asm volatile("mrs %0, cntpct_el0" : "=r"(time));
+
+    trace_ring *ring = &rings[mpidr & (TRACE_CORES - 1)];
+    trace_record *record = &ring->records[ring->next++ & (TRACE_RECORDS - 1)];
+    record->time = time;
+    record->function = (uint32_t)(unsigned long)function;
+    record->info = kind | ((mpidr & (TRACE_CORES - 1)) << TRACE_CORE_SHIFT);
+
+    asm volatile("msr daif, %0" : : "r"(daif) : "memory");
+}
+
+NO_TRACE void __cyg_profile_func_enter(void *function, void *call_site) {
+    trace_record_event(function, TRACE_ENTER);
+}
+
+NO_TRACE void __cyg_profile_func_exit(void *function, void *call_site) {
+    trace_record_event(function, 0);
+}
+
+/**
+ * Print every core's ring, oldest record first:
+ *   trace hz=<timer frequency> records=<n>
+ *   <core> <E|X> <time hex> <function hex>
+ *   end
+ */
+static void trace_dump() {
+    uint32_t total = 0;
+
+    for (int core = 0; core < TRACE_CORES; core++) {
+        total += rings[core].next < TRACE_RECORDS ? rings[core].next : TRACE_RECORDS;
+    }
+    printf("\ntrace hz=%lu records=%u\n", timer_frequency(), total);
+
+    for (int core = 0; core < TRACE_CORES; core++) {
+        trace_ring *ring = &rings[core];
+        uint32_t first = ring->next < TRACE_RECORDS ? 0 : ring->next - TRACE_RECORDS;
+        for (uint32_t i = first; i != ring->next; i++) {
+            trace_record *record = &ring->records[i & (TRACE_RECORDS - 1)];
+            printf("%d %c %lx %x\n", core, (record->info & TRACE_ENTER) ? 'E' : 'X', record->time,
+                   record->function);
+        }
+    }
+    printf("end\n");
+}
+
+static const char *const *completeTrace(int arg, char **argv) {
+    static const char *const actions[] = {"clear", "dump", "start", "stop", NULL};
+    return arg == 1 ? actions : NULL;
+}
+
+static int cmdTrace(int argc, char **argv) {
+    if (strcmp(argv[1], "start") == 0) {
+        enabled = 1;
+    } else if (strcmp(argv[1], "stop") == 0) {
+        enabled = 0;
+    } else if (strcmp(argv[1], "clear") == 0) {
+        for (int core = 0; core < TRACE_CORES; core++) {
+            rings[core].next = 0;
+        }
+    } else if (strcmp(argv[1], "dump") == 0) {
+        // Printing would otherwise fill the ring with its own calls
+        int was_enabled = enabled;
+        enabled = 0;
+        trace_dump();
+        enabled = was_enabled;
+    } else {
+        printf("\nUsage: trace start | stop | clear | dump\n");
+        return CMD_ERR_USAGE;
+    }
+    return CMD_OK;
+}
+
+#else
+
+static const char *const *completeTrace(int arg, char **argv) {
+    return NULL;
+}
+
+static int cmdTrace(int argc, char **argv) {
+    printf("\nTracing is not compiled in. Build with 'make trace'.\n");
+    return CMD_ERR_UNAVAILABLE;
+}
+
+#endif
+
+REGISTER_COMMAND_COMPLETE("trace", cmdTrace, completeTrace, 1, 1, "start | stop | clear | dump",
+                          "Function entry/exit trace (make trace).",
+                          "In a 'make trace' build every function call is recorded with a timestamp in a per-core "
+                          "ring of the latest 4096 events. trace stop/start pause and resume recording, trace clear "
+                          "empties the rings and trace dump prints them for tools/trace2chrome.py. "
+                          "Example: trace dump");
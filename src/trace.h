@@ -0,0 +1,34 @@
+// -----------------------------------trace.h -------------------------------------
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "gpio.h"
+
+/* Function entry/exit tracing ("make trace").
+ * The trace build compiles the kernel with -finstrument-functions, so every
+ * function calls the hooks in trace.c on entry and exit. Each call appends a
+ * 16-byte record to the running core's ring, overwriting the oldest, so the
+ * ring always holds the latest TRACE_RECORDS events. 'trace dump' prints
+ * them for tools/trace2chrome.py, which turns them into a chrome://tracing or
+ * Perfetto timeline.
+ *
+ * Hot or low-level code is left out, to keep the overhead down and the
+ * hooks from recursing: mark a function NO_TRACE, or add it to the
+ * TRACE_EXCLUDE lists in the Makefile (the UART and timer drivers and the
+ * inline helpers in pmu.h and irq.h are excluded there). */
+
+#define NO_TRACE __attribute__((no_instrument_function))
+
+#define TRACE_CORES 4
+#define TRACE_RECORDS 4096 // Per core, power of two
+
+#define TRACE_ENTER 1 // trace_record.info bit 0; clear for an exit
+#define TRACE_CORE_SHIFT 8
+
+typedef struct {
+    uint64_t time;     // Generic timer ticks
+    uint32_t function; // Address of the function (the kernel is below 4 GB)
+    uint32_t info;     // TRACE_ENTER, and the core number at TRACE_CORE_SHIFT
+} trace_record;
+
+#endif
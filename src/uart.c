@@ -1,8 +1,13 @@
 #include "uart.h"
+#include "timer.h"
 
 // Define constants for UART configuration
 #define UART_CLOCK 48000000 // Default UART clock frequency
 
+// Baud negotiation timing
+#define UART_NEGOTIATE_TIMEOUT_MS 2000 // How long to wait for the host's sync token
+#define UART_NEGOTIATE_QUIET_MS 50     // Idle time that ends the stream of retried sync tokens
+
 // Define default UART settings
 unsigned int baud_rate = 115200; // Default baud rate
 unsigned int data_bits = 8; // Default data bits
@@ -69,31 +74,128 @@ void uart_init()
  */
 void uart_set_baud_rate(unsigned int baud_rate)
 {
-    // Wait for the end of transmission or reception to avoid corruption
-    while(UART0_FR & UART_FR_BUSY) {
+    // Wait for the end of transmission so no character leaves at the wrong rate
+    uart_drain();
+
+    // Disable the UART before making changes, remembering the enabled features
+    unsigned int cr = UART0_CR;
+    UART0_CR = 0x0;
+
+    // Flush the FIFOs by clearing the FIFO enable bit in the line control register
+    unsigned int lcrh = UART0_LCRH;
+    UART0_LCRH = lcrh & ~UART0_LCRH_FEN;
+
+    // BAUDDIV = UART_CLOCK / (16 * baud_rate), computed in 1/64 steps so the
+    // fractional part is kept: IBRD = integer part, FBRD = round(fraction * 64)
+    unsigned int divider = (4 * UART_CLOCK + baud_rate / 2) / baud_rate;
+    UART0_IBRD = divider >> 6;
+    UART0_FBRD = divider & 0x3F;
+
+    // Writing LCRH latches the new divisor and restores the FIFO setting
+    UART0_LCRH = lcrh;
+
+    // Re-enable the UART with the new baud rate
+    UART0_CR = cr | 0x301; // Enable Tx, Rx, UART
+}
+
+/**
+ * Check that a baud rate can be produced by the divisor registers
+ */
+int uart_valid_baud_rate(unsigned int baud_rate)
+{
+    // IBRD must be at least 1 and fit in 16 bits
+    return baud_rate >= 300 && baud_rate <= UART_CLOCK / 16;
+}
+
+/**
+ * Change the console baud rate, i.e. the rate negotiated bursts return to
+ */
+void uart_set_console_baud_rate(unsigned int rate)
+{
+    baud_rate = rate;
+    uart_set_baud_rate(rate);
+}
+
+/**
+ * Wait until every queued character has been shifted out of the transmitter
+ */
+void uart_drain()
+{
+    while (!(UART0_FR & UART0_FR_TXFE) || (UART0_FR & UART0_FR_BUSY)) {
         asm volatile("nop");
     }
+}
 
-    // Disable the UART before making changes
-    UART0_CR = 0x0;
+/**
+ * Negotiate a new baud rate with the host.
+ *
+ * Protocol (see tools/baudswitch.py):
+ *   1. Kernel announces "BAUD <rate>" at the current rate and drains TX.
+ *   2. Both sides switch; the host repeats the token "SYNC" until answered.
+ *   3. Kernel answers "ACK" at the new rate and discards retried tokens.
+ * If no SYNC arrives within UART_NEGOTIATE_TIMEOUT_MS the kernel falls back
+ * to the console rate and reports "BAUD FAIL" there.
+ * @return 1 when the new rate is in use, 0 after a fallback
+ */
+int uart_negotiate_baud_rate(unsigned int rate)
+{
+    const char *sync = "SYNC";
+    int matched = 0;
 
-    // If FIFOs are enabled, flush them here
-    if (UART0_LCRH & UART0_LCRH_FEN) {
-        UART0_LCRH &= ~UART0_LCRH_FEN; // Clear FIFO enable bit
-        // Flush the FIFOs by clearing the FIFO enable bit in the line control register
+    if (!uart_valid_baud_rate(rate)) {
+        uart_puts("\nBAUD INVALID\n");
+        return 0;
     }
 
-    unsigned int ibrd, fbrd, divider;
-    divider = UART_CLOCK / (16 * baud_rate);
-    ibrd = (unsigned int)(divider);                 // Integer part of divider
-    fbrd = (unsigned int)((divider - ibrd) * 64 + 0.5); // Fractional part of divider, rounded
+    uart_puts("\nBAUD ");
+    uart_dec(rate);
+    uart_puts("\n");
+    uart_set_baud_rate(rate);
+
+    // Look for the sync token, ignoring garbage received while the host switches
+    uint64_t deadline = timer_ticks() + timer_usec_to_ticks(UART_NEGOTIATE_TIMEOUT_MS * 1000);
+    while (sync[matched] && timer_ticks() < deadline) {
+        if (UART0_FR & UART0_FR_RXFE) {
+            continue;
+        }
+        char c = (unsigned char) (UART0_DR);
+        if (c == sync[matched]) {
+            matched++;
+        } else {
+            matched = (c == sync[0]) ? 1 : 0;
+        }
+    }
 
-    // Set integer and fractional parts of baud rate
-    UART0_IBRD = ibrd;
-    UART0_FBRD = fbrd;
+    if (sync[matched]) {
+        uart_set_baud_rate(baud_rate);
+        uart_puts("\nBAUD FAIL\n");
+        return 0;
+    }
 
-    // Re-enable the UART with the new baud rate
-    UART0_CR = 0x301; // Enable Tx, Rx, FIFO
+    uart_puts("ACK\n");
+
+    // Swallow sync tokens the host sent before it saw the ACK
+    while (uart_getc_timeout(UART_NEGOTIATE_QUIET_MS) >= 0);
+
+    return 1;
+}
+
+/**
+ * End a bulk-transfer burst by negotiating back to the console rate
+ */
+void uart_burst_end()
+{
+    uart_negotiate_baud_rate(baud_rate);
+}
+
+/**
+ * Return to the console rate without the host, which has given up on the
+ * burst (after a failed transfer, or a long silence)
+ */
+void uart_burst_abort()
+{
+    uart_drain();
+    uart_set_baud_rate(baud_rate);
 }
 
 // Function to set the number of data bits
@@ -164,6 +266,22 @@ char uart_getc() {
     return (c == '\r' ? '\n' : c);
 }
 
+/**
+ * Receive a raw byte, giving up after the given number of milliseconds
+ * @return the byte, or -1 on timeout
+ */
+int uart_getc_timeout(unsigned int msec) {
+    uint64_t deadline = timer_ticks() + timer_usec_to_ticks(msec * 1000);
+
+    while (UART0_FR & UART0_FR_RXFE) {
+        if (timer_ticks() >= deadline) {
+            return -1;
+        }
+    }
+
+    return (unsigned char) (UART0_DR);
+}
+
 /**
  * Display a string
  */
@@ -157,6 +157,12 @@
 /* Function prototypes */
 void uart_init();
 void uart_set_baud_rate(unsigned int baud_rate);
+int uart_valid_baud_rate(unsigned int baud_rate);
+void uart_set_console_baud_rate(unsigned int rate);
+void uart_drain();
+int uart_negotiate_baud_rate(unsigned int rate);
+void uart_burst_end();
+void uart_burst_abort();
 
 unsigned int set_data_bits(unsigned int data_bits);
 unsigned int set_parity(char parity);
@@ -165,6 +171,7 @@ unsigned int set_rts_cts(char rts_cts);
 
 void uart_sendc(char c);
 char uart_getc();
+int uart_getc_timeout(unsigned int msec);
 void uart_puts(char *s);
 void uart_hex(unsigned int num);
 void uart_dec(int num);
\ No newline at end of file
@@ -0,0 +1,252 @@
+#include "uartbench.h"
+#include "uart.h"
+#include "timer.h"
+#include "command.h"
+#include "machine.h"
+#include "job.h"
+#include "utility.h"
+#include "bench.h"
+
+#define UARTBENCH_SEED 0x2545f491
+#define UARTBENCH_SLACK_USEC 10000   // Added to twice the line time before a run gives up
+#define UARTBENCH_BENCH_TIMEOUT_USEC 1000
+
+// Rates tested when none are given: those offered by 'setbaud'
+static const unsigned int uartbench_rates[] = {
+    9600, 19200, 38400, 57600, 115200, 230400, 460800, 921600, 1000000, 1500000, 2000000, 3000000
+};
+static const char uartbench_parities[] = {'N', 'E', 'O'};
+
+typedef struct {
+    unsigned int cr, lcrh, ibrd, fbrd;
+} uart_registers;
+
+/**
+ * Next character of the test pattern (xorshift32)
+ */
+static unsigned int uartbench_next(uint32_t *state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x >> 24;
+}
+
+/**
+ * Put UART0 in loopback with a frame format and rate, saving the console's setup
+ */
+static void uartbench_enter(unsigned int baud, unsigned int lcrh, uart_registers *saved) {
+    uart_drain();
+    saved->cr = UART0_CR;
+    saved->lcrh = UART0_LCRH;
+    saved->ibrd = UART0_IBRD;
+    saved->fbrd = UART0_FBRD;
+
+    UART0_CR = 0;
+    UART0_LCRH = lcrh;
+    UART0_CR = UART0_CR_LBE | UART0_CR_RXE | UART0_CR_TXE | UART0_CR_UARTEN;
+    uart_set_baud_rate(baud); // Flushes both FIFOs and keeps LBE
+    UART0_ICR = 0x7FF;
+    UART0_RSRECR = 0;
+}
+
+/**
+ * Leave loopback and restore the console's rate and frame format
+ */
+static void uartbench_leave(const uart_registers *saved) {
+    uart_drain();
+    UART0_CR = 0;
+    UART0_LCRH = saved->lcrh & ~UART0_LCRH_FEN; // Flush what the test left in the FIFOs
+    UART0_IBRD = saved->ibrd;
+    UART0_FBRD = saved->fbrd;
+    UART0_LCRH = saved->lcrh;                   // Latches the divisor
+    UART0_ICR = 0x7FF;
+    UART0_RSRECR = 0;
+    UART0_CR = saved->cr;
+}
+
+/**
+ * Wait for the transmitter to go idle, giving up at the deadline
+ */
+static void uartbench_wait_idle(uint64_t deadline) {
+    while ((!(UART0_FR & UART0_FR_TXFE) || (UART0_FR & UART0_FR_BUSY)) && timer_ticks() < deadline) {
+        asm volatile("nop");
+    }
+}
+
+/**
+ * Pump a pattern through UART0 in loopback with one frame format
+ * @return 1 if every character came back intact
+ */
+int uartbench_run(unsigned int baud, unsigned int data_bits, char parity, unsigned int stop_bits,
+                  uartbench_result *result) {
+    unsigned int frame_bits = 1 + data_bits + (parity != 'N') + stop_bits;
+    unsigned int mask = (1 << data_bits) - 1;
+    uint32_t tx_state = UARTBENCH_SEED, rx_state = UARTBENCH_SEED;
+    unsigned int sent = 0;
+    uart_registers saved;
+
+    *result = (uartbench_result){0};
+    result->bytes = baud / frame_bits * UARTBENCH_MSEC / 1000;
+    if (result->bytes < UARTBENCH_MIN_BYTES) {
+        result->bytes = UARTBENCH_MIN_BYTES;
+    } else if (result->bytes > UARTBENCH_MAX_BYTES) {
+        result->bytes = UARTBENCH_MAX_BYTES;
+    }
+    uint64_t line_usec = (uint64_t)(result->bytes + UARTBENCH_FIFO_PROBE) * frame_bits * 1000000 / baud;
+    uint64_t deadline = timer_usec_to_ticks(2 * line_usec + UARTBENCH_SLACK_USEC);
+
+    uartbench_enter(baud, UART0_LCRH_FEN | set_data_bits(data_bits) | set_parity(parity) | set_stop_bits(stop_bits),
+                    &saved);
+    uint64_t start = timer_ticks();
+    deadline += start;
+
+    // Keep at most a FIFO's worth in flight, so nothing can overrun
+    while (result->received < result->bytes && timer_ticks() < deadline) {
+        if (sent < result->bytes && sent - result->received < UARTBENCH_WINDOW && !(UART0_FR & UART0_FR_TXFF)) {
+            UART0_DR = uartbench_next(&tx_state) & mask;
+            sent++;
+        }
+
+        unsigned int burst = 0;
+        while (!(UART0_FR & UART0_FR_RXFE)) {
+            unsigned int data = UART0_DR;
+            unsigned int expected = uartbench_next(&rx_state) & mask;
+            result->framing += (data & UART0_DR_FE) != 0;
+            result->parity += (data & UART0_DR_PE) != 0;
+            result->breaks += (data & UART0_DR_BE) != 0;
+            result->overruns += (data & UART0_DR_OE) != 0;
+            if (!(data & (UART0_DR_FE | UART0_DR_PE | UART0_DR_BE)) &&
+                (data & 0xFF) != expected) {
+                result->mismatches++;
+            }
+            result->received++;
+            burst++;
+        }
+        if (burst > result->rx_peak) {
+            result->rx_peak = burst;
+        }
+    }
+    result->ticks = timer_ticks() - start;
+
+    // Depth probe: send more than the RX FIFO holds without reading, then count
+    while (!(UART0_FR & UART0_FR_RXFE)) {
+        (void)UART0_DR;
+    }
+    for (int i = 0; i < UARTBENCH_FIFO_PROBE && timer_ticks() < deadline; i++) {
+        while ((UART0_FR & UART0_FR_TXFF) && timer_ticks() < deadline) {
+            asm volatile("nop");
+        }
+        UART0_DR = i & mask;
+    }
+    uartbench_wait_idle(deadline);
+    while (!(UART0_FR & UART0_FR_RXFE)) {
+        (void)UART0_DR;
+        result->rx_depth++;
+    }
+
+    uartbench_leave(&saved);
+    return result->received == result->bytes && !result->framing && !result->parity && !result->breaks &&
+           !result->overruns && !result->mismatches;
+}
+
+/**
+ * Print one run: a table row, or a key=value record in machine mode
+ */
+static void uartbench_report(unsigned int baud, unsigned int data_bits, char parity, unsigned int stop_bits,
+                             const uartbench_result *result, int passed) {
+    unsigned int frame_bits = 1 + data_bits + (parity != 'N') + stop_bits;
+    double rate = result->ticks ? (double)result->received * timer_frequency() / result->ticks : 0;
+    double line = 100.0 * rate * frame_bits / baud;
+
+    if (machine_mode()) {
+        printf("%u-%u%c%u=bytes:%u,received:%u,bps:%.0f,line_pct:%.1f,rx_peak:%u,rx_fifo:%u,"
+               "framing:%u,parity:%u,break:%u,overrun:%u,mismatch:%u,passed:%d\n",
+               baud, data_bits, parity, stop_bits, result->bytes, result->received, rate, line, result->rx_peak,
+               result->rx_depth, result->framing, result->parity, result->breaks, result->overruns,
+               result->mismatches, passed);
+        return;
+    }
+    printf("%8u  %u%c%u %6u %6u %10.0f %6.1f%% %5u %5u %4u %4u %4u %4u %5u  %s\n", baud, data_bits, parity,
+           stop_bits, result->bytes, result->received, rate, line, result->rx_peak, result->rx_depth,
+           result->framing, result->parity, result->breaks, result->overruns, result->mismatches,
+           passed ? "ok" : "FAIL");
+}
+
+static int cmdUartBench(int argc, char **argv) {
+    unsigned int rates[CMD_MAX_ARGS];
+    int count = 0, passed = 0, failed = 0;
+
+    for (int i = 1; i < argc; i++) {
+        unsigned long rate;
+        if (!parse_number(argv[i], &rate) || rate > 0xFFFFFFFF || !uart_valid_baud_rate(rate)) {
+            printf("\nInvalid baud rate: %s\n", argv[i]);
+            return CMD_ERR_INVALID;
+        }
+        rates[count++] = rate;
+    }
+    if (!count) {
+        for (; count < sizeof(uartbench_rates) / sizeof(uartbench_rates[0]); count++) {
+            rates[count] = uartbench_rates[count];
+        }
+    }
+
+    if (!machine_mode()) {
+        printf("\n    Baud  Fmt  Bytes   Recv    Bytes/s   Line  RXpk RXfifo   FE   PE   BE   OE   Bad\n");
+    }
+    for (int r = 0; r < count; r++) {
+        for (unsigned int data_bits = 5; data_bits <= 8; data_bits++) {
+            for (int p = 0; p < sizeof(uartbench_parities); p++) {
+                for (unsigned int stop_bits = 1; stop_bits <= 2; stop_bits++) {
+                    uartbench_result result;
+                    int ok = uartbench_run(rates[r], data_bits, uartbench_parities[p], stop_bits, &result);
+                    uartbench_report(rates[r], data_bits, uartbench_parities[p], stop_bits, &result, ok);
+                    if (ok) {
+                        passed++;
+                    } else {
+                        failed++;
+                    }
+                    if (job_poll()) {
+                        return CMD_ERR_CANCELLED;
+                    }
+                }
+            }
+        }
+    }
+
+    if (!machine_mode()) {
+        printf("%d of %d frame formats passed\n", passed, passed + failed);
+    }
+    return failed ? CMD_ERR_FAILED : CMD_OK;
+}
+REGISTER_COMMAND("uartbench", cmdUartBench, 0, CMD_MAX_ARGS - 1, "[<baud>...]",
+                 "UART0 loopback self-test and throughput.",
+                 "Puts UART0 in internal loopback and sends a pattern at every data bit, parity and stop bit "
+                 "setting of each baud rate (all 'setbaud' rates by default), checking every character. Shows "
+                 "bytes/s and the share of the line rate achieved, the most characters read from the RX FIFO "
+                 "at once, how many it held when not read, and framing/parity/break/overrun errors and wrong "
+                 "characters. The console is silent during each run. Example: uartbench 115200 921600");
+
+// One character through the loopback at the console's settings, polled
+static void benchUartLoopback(unsigned int iterations, unsigned long arg) {
+    uart_drain();
+    unsigned int cr = UART0_CR;
+    UART0_CR = 0;
+    UART0_CR = cr | UART0_CR_LBE;
+
+    for (unsigned int i = 0; i < iterations; i++) {
+        uint64_t deadline = timer_ticks() + timer_usec_to_ticks(UARTBENCH_BENCH_TIMEOUT_USEC);
+        UART0_DR = 'U';
+        while ((UART0_FR & UART0_FR_RXFE) && timer_ticks() < deadline) {
+            asm volatile("nop");
+        }
+        (void)UART0_DR;
+    }
+
+    uart_drain();
+    UART0_CR = 0;
+    UART0_ICR = 0x7FF;
+    UART0_CR = cr;
+}
+REGISTER_BENCHMARK("uart-loopback", benchUartLoopback, 0, 1);
@@ -0,0 +1,45 @@
+// -----------------------------------uartbench.h -------------------------------------
+#ifndef UARTBENCH_H
+#define UARTBENCH_H
+
+#include "gpio.h"
+
+/* UART0 internal-loopback self-test ('uartbench').
+ * With UART0_CR_LBE set the PL011 feeds its transmitter straight into its
+ * receiver, so the driver's data path can be checked at any baud rate and
+ * frame format without a host on the other end. Each run reprograms the
+ * divisor and LCRH, pumps a pseudo-random pattern through with at most
+ * UARTBENCH_WINDOW characters in flight, checks every character and its
+ * error bits (DR[11:8]), then fills the receive FIFO without reading it to
+ * see how many characters it holds. The console settings are restored
+ * afterwards; nothing may be printed while a run is in loopback. The driver
+ * is polled (the BCM2835 PL011 has no DMA and the kernel takes no UART
+ * interrupts), so this is also the throughput ceiling of polled I/O. */
+
+#define UARTBENCH_WINDOW 16      // Characters in flight: never more than the RX FIFO holds
+#define UARTBENCH_FIFO_PROBE 32  // Sent unread to probe the RX FIFO depth
+#define UARTBENCH_MSEC 20        // Line time of the pattern per frame format
+#define UARTBENCH_MIN_BYTES 64
+#define UARTBENCH_MAX_BYTES 4096
+
+/* Error bits of a received character in UART0_DR */
+#define UART0_DR_FE (1 << 8)  // Framing error
+#define UART0_DR_PE (1 << 9)  // Parity error
+#define UART0_DR_BE (1 << 10) // Break
+#define UART0_DR_OE (1 << 11) // Overrun
+
+typedef struct {
+    unsigned int bytes;      // Pattern length
+    unsigned int received;   // Characters that came back before the timeout
+    uint64_t ticks;          // From the first write to the last read
+    unsigned int framing, parity, breaks, overruns;
+    unsigned int mismatches; // Characters that came back wrong without an error bit
+    unsigned int rx_peak;    // Most characters drained from the RX FIFO at once
+    unsigned int rx_depth;   // Characters the RX FIFO held in the depth probe
+} uartbench_result;
+
+/* Function prototypes */
+int uartbench_run(unsigned int baud, unsigned int data_bits, char parity, unsigned int stop_bits,
+                  uartbench_result *result);
+
+#endif
@@ -0,0 +1,99 @@
+#include "unwind.h"
+#include "ksyms.h"
+#include "printf.h"
+#include "command.h"
+
+#define UNWIND_RAM_START 0x1000 // Lowest address a stack can be at
+
+// End of the kernel image and BSS (link.ld); every stack is below it
+extern char _end[];
+
+/**
+ * Follow the frame record chain from fp, appending return addresses
+ * @return the new depth
+ */
+static int unwind_walk(uint64_t fp, uint64_t *pcs, int depth, int max) {
+#ifdef FRAME_POINTERS
+    while (depth < max) {
+        if (fp < UNWIND_RAM_START || fp + 16 > (uint64_t)_end || (fp & 7)) {
+            break;
+        }
+        const uint64_t *record = (const uint64_t *)fp;
+        uint64_t next = record[0], lr = record[1];
+        if (lr == 0) {
+            break;
+        }
+        pcs[depth++] = lr;
+        if (next <= fp || next - fp > UNWIND_MAX_FRAME_SIZE) {
+            break;
+        }
+        fp = next;
+    }
+#endif
+    return depth;
+}
+
+/**
+ * Call stack of interrupted code, innermost first: the exception return
+ * address, then the callers. If the code was stopped in a function's
+ * prologue, before it set up its frame record, its caller is missed.
+ * @return number of PCs stored
+ */
+int unwind_exception(const exception_frame *frame, uint64_t *pcs, int max) {
+    if (max < 1) {
+        return 0;
+    }
+    pcs[0] = frame->elr;
+    return unwind_walk(frame->x[29], pcs, 1, max);
+}
+
+/**
+ * Call stack of the caller of this function, innermost first
+ * @return number of PCs stored
+ */
+int unwind_here(uint64_t *pcs, int max) {
+    uint64_t fp = (uint64_t)__builtin_frame_address(0);
+
+    if (max < 1) {
+        return 0;
+    }
+    pcs[0] = (uint64_t)__builtin_return_address(0);
+#ifdef FRAME_POINTERS
+    // Our own record holds the caller's frame pointer
+    return unwind_walk(((const uint64_t *)fp)[0], pcs, 1, max);
+#else
+    (void)fp;
+    return 1;
+#endif
+}
+
+/**
+ * Print a call stack, with function names when the image has a symbol table
+ */
+void unwind_print(const uint64_t *pcs, int depth) {
+    for (int i = 0; i < depth; i++) {
+        uint64_t offset;
+        // Return addresses point after the call; look up the call itself
+        const char *name = ksyms_lookup(i ? pcs[i] - 4 : pcs[i], &offset);
+        if (name) {
+            printf("  #%d %lx %s+0x%lx\n", i, pcs[i], name, i ? offset + 4 : offset);
+        } else {
+            printf("  #%d %lx\n", i, pcs[i]);
+        }
+    }
+}
+
+static int cmdBacktrace(int argc, char **argv) {
+    uint64_t pcs[UNWIND_MAX_DEPTH];
+
+    printf("\n");
+    unwind_print(pcs, unwind_here(pcs, UNWIND_MAX_DEPTH));
+#ifndef FRAME_POINTERS
+    printf("Build with 'make FRAME_POINTERS=1' for the callers\n");
+#endif
+    return CMD_OK;
+}
+REGISTER_COMMAND("backtrace", cmdBacktrace, 0, 0, "",
+                 "Show the CLI's current call stack.",
+                 "Walks the frame records of the running code and prints each return address, named from "
+                 "the embedded symbol table. Needs a 'make FRAME_POINTERS=1' build for more than one frame.");
@@ -0,0 +1,24 @@
+// -----------------------------------unwind.h -------------------------------------
+#ifndef UNWIND_H
+#define UNWIND_H
+
+#include "irq.h"
+
+/* Call stacks from AArch64 frame records.
+ * With "make FRAME_POINTERS=1" every function keeps x29 pointing at a
+ * {previous x29, return address} pair on its stack, so the chain can be
+ * followed from an exception frame or from the running code. The walk is
+ * bounded: at most the requested depth, and it stops at the first record
+ * outside RAM, not above the previous one, or further than
+ * UNWIND_MAX_FRAME_SIZE from it. Without frame pointers only the first PC
+ * is returned, since x29 is then an ordinary register. */
+
+#define UNWIND_MAX_DEPTH 16
+#define UNWIND_MAX_FRAME_SIZE 0x10000 // printf alone has a 10 KB frame
+
+/* Function prototypes */
+int unwind_exception(const exception_frame *frame, uint64_t *pcs, int max);
+int unwind_here(uint64_t *pcs, int max);
+void unwind_print(const uint64_t *pcs, int depth);
+
+#endif
@@ -20,6 +20,19 @@ int strncmp(const char *string1, const char *string2, size_t n)
     return *(unsigned char *)string1 - *(unsigned char *)string2;
 }
 
+// Custom exact string comparison function
+int strcmp(const char *string1, const char *string2)
+{
+    // Compare characters until they differ or both strings end
+    while (*string1 && (*string1 == *string2))
+    {
+        string1++;
+        string2++;
+    }
+
+    return *(unsigned char *)string1 - *(unsigned char *)string2;
+}
+
 // Custom string copying function
 char *strncpy(char *destination, const char *source, size_t n)
 {
@@ -162,6 +175,115 @@ char *strstr(const char *haystack, const char *needle)
     return NULL;
 }
 
+// Parse a whole argument as an unsigned number, decimal or 0x-prefixed hexadecimal.
+// Returns 1 on success, 0 for an empty string, any other character, or overflow
+int parse_number(const char *string, unsigned long *value)
+{
+    unsigned long base = 10, result = 0;
+
+    if (string[0] == '0' && (string[1] == 'x' || string[1] == 'X'))
+    {
+        base = 16;
+        string += 2;
+    }
+    if (!*string)
+    {
+        return 0;
+    }
+
+    for (; *string; string++)
+    {
+        unsigned long digit;
+        if (*string >= '0' && *string <= '9')
+        {
+            digit = *string - '0';
+        }
+        else if (base == 16 && *string >= 'a' && *string <= 'f')
+        {
+            digit = *string - 'a' + 10;
+        }
+        else if (base == 16 && *string >= 'A' && *string <= 'F')
+        {
+            digit = *string - 'A' + 10;
+        }
+        else
+        {
+            return 0;
+        }
+        if (result > (~0UL - digit) / base)
+        {
+            return 0;
+        }
+        result = result * base + digit;
+    }
+    *value = result;
+    return 1;
+}
+
+/* The compiler turns byte loops like the ones below into memcpy()/memset()
+calls, which would make these functions call themselves */
+#define NO_LIBCALLS __attribute__((optimize("no-tree-loop-distribute-patterns")))
+
+// Custom memory copying function: 8 bytes at a time when both pointers are aligned alike
+NO_LIBCALLS void *memcpy(void *destination, const void *source, size_t n)
+{
+    unsigned char *d = destination;
+    const unsigned char *s = source;
+
+    if ((((uintptr_t)d ^ (uintptr_t)s) & 7) == 0)
+    {
+        // Copy single bytes up to the first aligned address, then whole words
+        while (n > 0 && ((uintptr_t)d & 7))
+        {
+            *d++ = *s++;
+            n--;
+        }
+        while (n >= 8)
+        {
+            *(uint64_t *)d = *(const uint64_t *)s;
+            d += 8;
+            s += 8;
+            n -= 8;
+        }
+    }
+
+    // Copy the remaining (or misaligned) bytes one at a time
+    while (n > 0)
+    {
+        *d++ = *s++;
+        n--;
+    }
+    return destination;
+}
+
+// Custom memory filling function: 8 bytes at a time once the pointer is aligned
+NO_LIBCALLS void *memset(void *destination, int value, size_t n)
+{
+    unsigned char *d = destination;
+    uint64_t pattern = (unsigned char)value * 0x0101010101010101ull;
+
+    while (n > 0 && ((uintptr_t)d & 7))
+    {
+        *d++ = (unsigned char)value;
+        n--;
+    }
+    while (n >= 8)
+    {
+        *(uint64_t *)d = pattern;
+        d += 8;
+        n -= 8;
+    }
+    while (n > 0)
+    {
+        *d++ = (unsigned char)value;
+        n--;
+    }
+    return destination;
+}
+
+// Color names understood by mapColorToCodeText and mapColorToCodeBackground
+const char *const colorNames[] = {"black", "red", "green", "yellow", "blue", "purple", "cyan", "white", NULL};
+
 // Function to map color names to ANSI escape codes
 const char *mapColorToCodeText(const char *colorName) {
     // Implement a mapping here from color names to ANSI escape codes
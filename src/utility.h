@@ -1,11 +1,16 @@
 #include "mbox.h"
 
 int strncmp(const char *string1, const char *string2, size_t n);
+int strcmp(const char *string1, const char *string2);
 char *strncpy(char *destination, const char *source, size_t n);
 size_t strlen(const char *string);
 int is_delimiter(char c, const char *delimiter);
 char *strtok_r(char *string, const char *delimiter, char **saveptr);
 char *strstr(const char *haystack, const char *needle);
+void *memcpy(void *destination, const void *source, size_t n);
+void *memset(void *destination, int value, size_t n);
+int parse_number(const char *string, unsigned long *value);
 
+extern const char *const colorNames[];
 const char *mapColorToCodeText(const char *colorName);
 const char *mapColorToCodeBackground(const char *colorName);
@@ -0,0 +1,170 @@
+#!/usr/bin/env python3
+"""Host side of the DoorOS baud negotiation protocol.
+
+Runs one DoorOS command at a temporarily raised baud rate and prints its
+output, then negotiates back to the console rate:
+
+    host                                kernel
+    "baudswitch <rate>\\n"     ---->
+                              <----    "BAUD <rate>"   (old rate, TX drained)
+    switch line to <rate>
+    "SYNC" (repeated)          ---->
+                              <----    "ACK"           (new rate)
+    "<command>\\n"             ---->
+                              <----    output ... "DoorOS> "
+    "baudswitch end\\n"        ---->    same handshake back to the console rate
+
+If the kernel does not see SYNC within its timeout it reports "BAUD FAIL" at
+the console rate, which is also where this script falls back.
+
+Transports:
+    --tty /dev/ttyUSB0      a real serial port (the line rate is switched)
+    --pipe /tmp/dooros      a QEMU "-serial pipe:/tmp/dooros" FIFO pair
+                            (see "make run-pipe"; QEMU ignores the divisor so
+                            only the protocol is exercised)
+
+Example:
+    tools/baudswitch.py --pipe /tmp/dooros --rate 921600 currentuartsettings
+"""
+
+import argparse
+import os
+import re
+import select
+import sys
+import time
+
+try:
+    import termios
+except ImportError:  # pragma: no cover - non-POSIX hosts
+    termios = None
+
+PROMPT = b"DoorOS> "
+BAUD_REPLY = re.compile(rb"BAUD (\d+|INVALID)\r?\n")
+SYNC_RETRY = 0.25      # seconds between SYNC tokens
+SYNC_TIMEOUT = 3.0     # longer than the kernel's 2 s so it gives up first
+
+
+class Link:
+    """A byte pipe to the board with an optionally switchable line rate."""
+
+    def __init__(self, tty=None, pipe=None, baud=115200):
+        if tty:
+            self.rfd = self.wfd = os.open(tty, os.O_RDWR | os.O_NOCTTY)
+            self.is_tty = True
+            self.set_rate(baud)
+        else:
+            # QEMU reads <path>.in and writes <path>.out
+            self.wfd = os.open(pipe + ".in", os.O_WRONLY)
+            self.rfd = os.open(pipe + ".out", os.O_RDONLY)
+            self.is_tty = False
+        self.pending = b""   # Received but not yet consumed
+        self.consumed = b""  # What the last read_match() took from the buffer
+
+    def set_rate(self, baud):
+        if not self.is_tty or termios is None:
+            return
+        speed = getattr(termios, "B%d" % baud, None)
+        if speed is None:
+            raise SystemExit("host serial driver does not support %d bps" % baud)
+        attrs = termios.tcgetattr(self.rfd)
+        attrs[0] = 0                                   # iflag: raw
+        attrs[1] = 0                                   # oflag: raw
+        attrs[2] = termios.CS8 | termios.CREAD | termios.CLOCAL
+        attrs[3] = 0                                   # lflag: raw
+        attrs[4] = attrs[5] = speed
+        termios.tcdrain(self.wfd)
+        termios.tcsetattr(self.rfd, termios.TCSANOW, attrs)
+        termios.tcflush(self.rfd, termios.TCIFLUSH)
+
+    def write(self, data):
+        os.write(self.wfd, data)
+
+    def fill(self, deadline):
+        """Add whatever arrives before the deadline to the receive buffer; False on timeout."""
+        left = deadline - time.monotonic()
+        if left <= 0 or not select.select([self.rfd], [], [], left)[0]:
+            return False
+        self.pending += os.read(self.rfd, 4096)
+        return True
+
+    def read_match(self, pattern, timeout):
+        """Read until the compiled bytes pattern matches; consume up to the end of
+        the match and return the match, or None on timeout. Bytes after the match
+        stay in the buffer for the next read."""
+        deadline = time.monotonic() + timeout
+        while True:
+            match = pattern.search(self.pending)
+            if match:
+                self.consumed = self.pending[:match.end()]
+                self.pending = self.pending[match.end():]
+                return match
+            if not self.fill(deadline):
+                return None
+
+    def read_until(self, token, timeout):
+        """Read until token is seen; return everything up to and including it or None on timeout."""
+        if self.read_match(re.compile(re.escape(token)), timeout) is None:
+            return None
+        return self.consumed
+
+
+def negotiate(link, rate, console, command):
+    """Ask for a new rate with the given command; return the rate in use."""
+    link.write(command)
+    # Usually arrives in one read together with its newline
+    reply = link.read_match(BAUD_REPLY, 2.0)
+    if reply is None:
+        raise SystemExit("kernel did not answer the baud request")
+    if reply.group(1) == b"INVALID":
+        return console
+
+    link.set_rate(rate)
+    deadline = time.monotonic() + SYNC_TIMEOUT
+    while time.monotonic() < deadline:
+        link.write(b"SYNC")
+        if link.read_until(b"ACK", SYNC_RETRY) is not None:
+            # Let the kernel finish discarding retried tokens
+            time.sleep(0.1)
+            return rate
+
+    link.set_rate(console)
+    link.read_until(b"BAUD FAIL", 2.0)
+    return console
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    where = parser.add_mutually_exclusive_group(required=True)
+    where.add_argument("--tty", help="serial device connected to UART0")
+    where.add_argument("--pipe", help="QEMU serial pipe path (without .in/.out)")
+    parser.add_argument("--rate", type=int, default=921600, help="burst baud rate")
+    parser.add_argument("--console", type=int, default=115200, help="console baud rate")
+    parser.add_argument("--timeout", type=float, default=30.0,
+                        help="seconds to wait for the command to finish")
+    parser.add_argument("command", nargs="+", help="DoorOS command to run in the burst")
+    args = parser.parse_args()
+
+    link = Link(tty=args.tty, pipe=args.pipe, baud=args.console)
+
+    rate = negotiate(link, args.rate, args.console,
+                     b"baudswitch %d\n" % args.rate)
+    if rate != args.rate:
+        print("negotiation failed, running at %d bps" % rate, file=sys.stderr)
+    # The baudswitch command ends with a prompt (at the rate now in use)
+    if link.read_until(PROMPT, 5.0) is None:
+        raise SystemExit("no prompt after the baud negotiation")
+
+    link.write(" ".join(args.command).encode() + b"\n")
+    output = link.read_until(PROMPT, args.timeout)
+    if output is None:
+        raise SystemExit("command did not finish within %.0f s" % args.timeout)
+    sys.stdout.buffer.write(output[:output.rfind(PROMPT)])
+
+    if rate != args.console:
+        negotiate(link, args.console, args.console, b"baudswitch end\n")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,160 @@
+#!/usr/bin/env python3
+"""Run the DoorOS microbenchmarks headless under QEMU and compare them.
+
+Boots the kernel in qemu-system-aarch64 with the serial port on a private
+FIFO pair and no display, waits for the prompt, switches to machine mode
+and runs "bench" (optionally only the named benchmarks). Each result comes
+back as a key=value record:
+
+    memcpy-4k=iterations:4096,cycles:512.00,cycles_mad:1.00,ns:845.00,ns_mad:2.00,mbps:4847.3
+
+A benchmark that could not run (irq-timer while the profiler owns the
+timer) reports "unavailable:1" instead and is skipped in the comparison.
+The results are written as JSON and, if a baseline file exists, compared
+with it: a benchmark whose median grew by more than --threshold percent
+is a regression, and the exit status is then 1. --update-baseline stores
+this run as the new baseline instead. "make bench" and "make bench-baseline"
+build an RPI3 kernel (the board QEMU emulates) and run this script.
+
+Examples:
+    tools/benchrun.py kernel8.img --baseline bench-baseline.json
+    tools/benchrun.py kernel8.img --threshold 5 memcpy printf
+"""
+
+import argparse
+import json
+import os
+import subprocess
+import sys
+import tempfile
+import time
+
+from baudswitch import Link, PROMPT
+from machine import Machine, STATUS_TRUNCATED, parse_records
+
+METRICS = ("cycles", "ns")
+
+
+def boot(args, fifo):
+    """Start QEMU on the FIFO pair and wait for the CLI prompt."""
+    os.mkfifo(fifo + ".in")
+    os.mkfifo(fifo + ".out")
+    command = [args.qemu, "-M", args.machine, "-smp", str(args.smp), "-kernel", args.kernel,
+               "-serial", "pipe:" + fifo, "-display", "none", "-monitor", "none"] + args.qemu_arg
+    qemu = subprocess.Popen(command, stdin=subprocess.DEVNULL)
+
+    # Opening the FIFOs blocks until QEMU has opened its ends
+    link = Link(pipe=fifo)
+    if link.read_until(PROMPT, args.boot_timeout) is None:
+        qemu.kill()
+        raise SystemExit("benchrun: no prompt from the kernel within %g s" % args.boot_timeout)
+    return qemu, link
+
+
+def run(args):
+    """Return {benchmark: {key: value}} from one 'bench' run."""
+    with tempfile.TemporaryDirectory(prefix="dooros-bench-") as directory:
+        qemu, link = boot(args, os.path.join(directory, "serial"))
+        try:
+            machine = Machine(link, args.timeout)
+            machine.enter()
+            status, payload = machine.command(" ".join(["bench"] + args.benchmark))
+        finally:
+            qemu.kill()
+            qemu.wait()
+
+    if status & STATUS_TRUNCATED:
+        print("benchrun: output truncated by the machine mode capture buffer", file=sys.stderr)
+    if status & ~STATUS_TRUNCATED:
+        raise SystemExit("benchrun: bench failed with status %d: %s"
+                         % (status & ~STATUS_TRUNCATED, payload.decode(errors="replace").strip()))
+
+    results = {}
+    for name, value in parse_records(payload).items():
+        fields = dict(field.split(":", 1) for field in value.split(",") if ":" in field)
+        results[name] = {key: float(number) for key, number in fields.items()}
+    return results
+
+
+def compare(results, baseline, metric, threshold):
+    """Print old and new medians side by side; return the regressed benchmarks."""
+    regressions = []
+    print("%-16s %12s %12s %8s" % ("benchmark", "baseline", "now", "change"))
+    for name, result in results.items():
+        old = baseline.get(name, {}).get(metric)
+        new = result.get(metric)
+        if "unavailable" in result:
+            print("%-16s %12s %12s %8s" % (name, "-" if old is None else "%.2f" % old, "-", "skipped"))
+            continue
+        if old is None or new is None:
+            print("%-16s %12s %12.2f %8s" % (name, "-", new or 0, "new"))
+            continue
+        change = 100.0 * (new - old) / old if old else 0.0
+        flag = ""
+        if change > threshold:
+            regressions.append(name)
+            flag = "  REGRESSION"
+        print("%-16s %12.2f %12.2f %+7.1f%%%s" % (name, old, new, change, flag))
+    for name in baseline:
+        if name not in results:
+            print("%-16s %12.2f %12s %8s" % (name, baseline[name].get(metric, 0), "-", "gone"))
+    return regressions
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("kernel", help="kernel image built for RPI3, e.g. kernel8.img")
+    parser.add_argument("benchmark", nargs="*", help="benchmark name prefixes (default: all)")
+    parser.add_argument("-o", "--output", default="build/bench.json", help="JSON file for this run")
+    parser.add_argument("--baseline", default="bench-baseline.json", help="JSON file to compare with")
+    parser.add_argument("--update-baseline", action="store_true", help="store this run as the baseline")
+    parser.add_argument("--threshold", type=float, default=10.0,
+                        help="percent slowdown that counts as a regression")
+    parser.add_argument("--metric", choices=METRICS, default="ns", help="median to compare")
+    parser.add_argument("--qemu", default="qemu-system-aarch64", help="QEMU binary")
+    parser.add_argument("--machine", default="raspi3", help="QEMU machine")
+    parser.add_argument("--smp", type=int, default=4, help="CPU count given to QEMU")
+    parser.add_argument("--qemu-arg", action="append", default=[], help="extra QEMU argument (repeatable)")
+    parser.add_argument("--boot-timeout", type=float, default=30.0, help="seconds to wait for the prompt")
+    parser.add_argument("--timeout", type=float, default=600.0, help="seconds to wait for the results")
+    args = parser.parse_args()
+
+    started = time.time()
+    results = run(args)
+    if not results:
+        raise SystemExit("benchrun: no benchmark results")
+    report = {
+        "kernel": args.kernel,
+        "machine": args.machine,
+        "smp": args.smp,
+        "date": time.strftime("%Y-%m-%dT%H:%M:%S", time.localtime(started)),
+        "results": results,
+    }
+
+    if os.path.dirname(args.output):
+        os.makedirs(os.path.dirname(args.output), exist_ok=True)
+    with open(args.output, "w") as out:
+        json.dump(report, out, indent=2, sort_keys=True)
+    print("%d benchmarks written to %s" % (len(results), args.output))
+
+    if args.update_baseline:
+        with open(args.baseline, "w") as out:
+            json.dump(report, out, indent=2, sort_keys=True)
+        print("baseline %s updated" % args.baseline)
+        return
+    if not os.path.exists(args.baseline):
+        print("no baseline %s to compare with (make bench-baseline records one)" % args.baseline)
+        return
+
+    with open(args.baseline) as f:
+        baseline = json.load(f)["results"]
+    regressions = compare(results, baseline, args.metric, args.threshold)
+    if regressions:
+        print("%d regression(s) over %g%%: %s" % (len(regressions), args.threshold, " ".join(regressions)))
+        sys.exit(1)
+    print("no regression over %g%%" % args.threshold)
+
+
+if __name__ == "__main__":
+    main()
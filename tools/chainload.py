@@ -0,0 +1,90 @@
+#!/usr/bin/env python3
+"""Send a kernel image to the DoorOS serial loader (make loader).
+
+Waits for the loader's "DOORLOAD" request, optionally negotiates a faster
+line rate, then sends the length-prefixed, CRC-32 protected image. See
+src/loader/loader.c for the protocol.
+
+Examples:
+    tools/chainload.py --tty /dev/ttyUSB0 --rate 921600 kernel8.img
+    tools/chainload.py --pipe /tmp/dooros kernel8.img      (make run-loader)
+"""
+
+import argparse
+import os
+import re
+import struct
+import sys
+import time
+import zlib
+
+from baudswitch import Link, negotiate
+
+REQUEST = b"DOORLOAD"
+
+
+def expect(link, tokens, timeout):
+    """Wait for one of the two-letter replies; return it or None."""
+    match = link.read_match(re.compile(b"|".join(re.escape(token) for token in tokens)), timeout)
+    return match.group(0) if match else None
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    where = parser.add_mutually_exclusive_group(required=True)
+    where.add_argument("--tty", help="serial device connected to UART0")
+    where.add_argument("--pipe", help="QEMU serial pipe path (without .in/.out)")
+    parser.add_argument("--rate", type=int, default=115200, help="transfer baud rate")
+    parser.add_argument("--console", type=int, default=115200, help="console baud rate")
+    parser.add_argument("--wait", type=float, default=60.0,
+                        help="seconds to wait for the loader (reset the board meanwhile)")
+    parser.add_argument("--tail", action="store_true",
+                        help="copy the new kernel's output to stdout after booting it")
+    parser.add_argument("image", help="kernel image, e.g. kernel8.img")
+    args = parser.parse_args()
+
+    with open(args.image, "rb") as f:
+        image = f.read()
+    crc = zlib.crc32(image) & 0xFFFFFFFF
+
+    link = Link(tty=args.tty, pipe=args.pipe, baud=args.console)
+    print("waiting for loader...", file=sys.stderr)
+    if link.read_until(REQUEST, args.wait) is None:
+        raise SystemExit("no DOORLOAD request from the board")
+
+    rate = args.console
+    if args.rate != args.console:
+        rate = negotiate(link, args.rate, args.console, b"B" + struct.pack("<I", args.rate))
+        if rate != args.rate:
+            print("negotiation failed, sending at %d bps" % rate, file=sys.stderr)
+
+    link.write(b"L" + struct.pack("<II", len(image), crc))
+    reply = expect(link, (b"OK", b"SZ", b"TO"), 5.0)
+    if reply != b"OK":
+        raise SystemExit("loader rejected the header: %r" % reply)
+
+    start = time.monotonic()
+    link.write(image)
+    reply = expect(link, (b"OK", b"CR", b"TO"), 10.0 + len(image) * 10.0 / rate)
+    if reply != b"OK":
+        raise SystemExit("transfer failed: %r" % reply)
+    elapsed = time.monotonic() - start
+    print("sent %d bytes (crc32 %08x) in %.2f s" % (len(image), crc, elapsed), file=sys.stderr)
+
+    # The new kernel's uart_init() returns to the console rate
+    link.set_rate(args.console)
+
+    if args.tail:
+        try:
+            sys.stdout.buffer.write(link.pending)
+            while True:
+                data = os.read(link.rfd, 4096)
+                sys.stdout.buffer.write(data)
+                sys.stdout.flush()
+        except KeyboardInterrupt:
+            pass
+
+
+if __name__ == "__main__":
+    main()
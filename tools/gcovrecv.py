@@ -0,0 +1,138 @@
+#!/usr/bin/env python3
+"""Receive .gcda profile data from a DoorOS "make pgo-gen" kernel.
+
+"gcov dump" prints each object file's counters in the .gcda format, as
+hex, between a header naming the file and its build path and an end line
+with the CRC-32 of the block:
+
+    gcda 3 1412 0 /home/user/dooros/build/cli.gcda
+    6164636742323031...
+    ...
+    end 5e1f0a2c
+
+With an object number ("gcov dump 3 4096") only a chunk of one file is
+printed, which is how files larger than the machine mode capture buffer are
+fetched. This script reassembles the blocks, checks them and writes each
+file into --dir (build by default, next to the objects "make pgo-use"
+compiles), or to the path the kernel reports with --keep-paths. The dump is
+read from a file (for example a terminal log), or fetched from the board in
+machine mode.
+
+Examples:
+    tools/gcovrecv.py capture.log
+    tools/gcovrecv.py --pipe /tmp/dooros        (make run-pipe)
+    make pgo-use
+"""
+
+import argparse
+import os
+import re
+import sys
+import zlib
+
+HEADER = re.compile(r"^gcda (\d+) (\d+) (\d+) (.+)$")
+END = re.compile(r"^end ([0-9a-fA-F]+)$")
+
+
+def parse_dump(text):
+    """Return {path: bytes} for the complete files in text; later blocks win."""
+    files = {}  # path -> (size, bytearray, set of (offset, length) received)
+    current = None
+    for line in text.splitlines():
+        line = line.strip()
+        match = HEADER.match(line)
+        if match:
+            current = (int(match.group(2)), int(match.group(3)), match.group(4), bytearray())
+            continue
+        if current is None:
+            continue
+        match = END.match(line)
+        if match:
+            size, offset, path, data = current
+            current = None
+            if zlib.crc32(data) != int(match.group(1), 16) or offset + len(data) > size:
+                print("warning: damaged block of %s at offset %d skipped" % (path, offset), file=sys.stderr)
+                continue
+            if path not in files or files[path][0] != size:
+                files[path] = (size, bytearray(size), set())
+            files[path][1][offset:offset + len(data)] = data
+            files[path][2].add((offset, len(data)))
+            continue
+        try:
+            current[3].extend(bytes.fromhex(line))
+        except ValueError:
+            current = None  # Something else interrupted the block
+
+    complete = {}
+    for path, (size, data, blocks) in files.items():
+        covered = 0
+        for offset, length in sorted(blocks):
+            if offset > covered:
+                break
+            covered = max(covered, offset + length)
+        if covered < size:
+            print("warning: %s incomplete (%d of %d bytes)" % (path, covered, size), file=sys.stderr)
+            continue
+        complete[path] = bytes(data)
+    return complete
+
+
+def fetch(args):
+    """Run 'gcov list' and 'gcov dump' on the board in machine mode."""
+    from baudswitch import Link
+    from machine import Machine, parse_records
+
+    machine = Machine(Link(tty=args.tty, pipe=args.pipe, baud=args.baud))
+    machine.enter()
+    status, payload = machine.command("gcov list")
+    if status != 0:
+        raise SystemExit("gcov list failed: %s" % payload.decode(errors="replace").strip())
+
+    text = []
+    for index, record in sorted(parse_records(payload).items(), key=lambda item: int(item[0])):
+        size = int(re.match(r"bytes:(\d+)", record).group(1))
+        offset = 0
+        while offset < size:
+            # Offset 0 makes the kernel take a fresh snapshot; later chunks come from it
+            status, payload = machine.command("gcov dump %s %d" % (index, offset))
+            if status != 0:
+                raise SystemExit("gcov dump failed: %s" % payload.decode(errors="replace").strip())
+            lines = payload.decode(errors="replace").strip().splitlines()
+            if not lines or not HEADER.match(lines[0]) or not END.match(lines[-1]):
+                raise SystemExit("no gcda block in reply to gcov dump %s %d" % (index, offset))
+            text.extend(lines)
+            offset += sum(len(line) // 2 for line in lines[1:-1])
+    return "\n".join(text)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("dump", nargs="?", help="file holding 'gcov dump' output (- for stdin)")
+    parser.add_argument("--tty", help="fetch the data over this serial device instead")
+    parser.add_argument("--pipe", help="fetch the data over this QEMU serial pipe instead")
+    parser.add_argument("--baud", type=int, default=115200, help="console baud rate")
+    parser.add_argument("--dir", default="build", help="directory for the .gcda files")
+    parser.add_argument("--keep-paths", action="store_true",
+                        help="write each file to the build path reported by the kernel")
+    args = parser.parse_args()
+
+    if args.tty or args.pipe:
+        text = fetch(args)
+    elif args.dump:
+        text = sys.stdin.read() if args.dump == "-" else open(args.dump, errors="replace").read()
+    else:
+        parser.error("give a dump file, --tty or --pipe")
+
+    files = parse_dump(text)
+    if not files:
+        raise SystemExit("no complete 'gcov dump' output found")
+    for path, data in sorted(files.items()):
+        target = path if args.keep_paths else os.path.join(args.dir, os.path.basename(path))
+        with open(target, "wb") as out:
+            out.write(data)
+        print("%s: %d bytes" % (target, len(data)))
+
+
+if __name__ == "__main__":
+    main()
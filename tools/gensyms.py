@@ -0,0 +1,64 @@
+#!/usr/bin/env python3
+"""Generate the kernel's embedded symbol table (src/ksyms.h).
+
+Reads "nm -n --defined-only" output for the first-pass kernel8.elf on stdin
+and writes an assembly file with the .ksyms section to stdout; the Makefile
+assembles it and links the kernel a second time with it:
+
+    aarch64-none-elf-nm -n --defined-only build/kernel8.elf | tools/gensyms.py > build/ksyms.S
+
+Only functions (nm types t, T, w, W) are kept. Names are deduplicated per
+address (the first one wins) and a final entry with an empty name marks the
+end of the code, so addresses in data are not attributed to the last function.
+"""
+
+import sys
+
+MAGIC = 0x4D59534B  # "KSYM"
+
+
+def parse(lines):
+    functions, others = [], []
+    for line in lines:
+        fields = line.split()
+        if len(fields) != 3:
+            continue
+        address, kind, name = int(fields[0], 16), fields[1], fields[2]
+        if kind in "tTwW":
+            if name.startswith("$") or name.startswith(".L"):
+                continue  # Mapping symbols and local labels
+            if not functions or functions[-1][0] != address:
+                functions.append((address, name))
+        elif kind not in "aA":
+            others.append(address)
+
+    # The code ends at the first data symbol after the last function
+    last = functions[-1][0] if functions else 0
+    code_end = min([address for address in others if address > last] or [last + 4])
+    return functions, code_end
+
+
+def main():
+    functions, code_end = parse(sys.stdin)
+    entries = functions + [(code_end, "")]
+
+    names, offsets = bytearray(), []
+    for _, name in entries:
+        offsets.append(len(names))
+        names += name.encode() + b"\0"
+
+    out = sys.stdout
+    out.write("// Generated by tools/gensyms.py; do not edit\n")
+    out.write('.section ".ksyms", "a"\n')
+    out.write(".balign 8\n")
+    out.write(".4byte 0x%08x, %d\n" % (MAGIC, len(entries)))
+    for (address, name), offset in zip(entries, offsets):
+        if address > 0xFFFFFFFF:
+            sys.exit("gensyms: %s at 0x%x does not fit in 32 bits" % (name, address))
+        out.write(".4byte 0x%08x, %d\t// %s\n" % (address, offset, name))
+    for start in range(0, len(names), 16):
+        out.write(".byte %s\n" % ", ".join(str(b) for b in names[start:start + 16]))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,122 @@
+#!/usr/bin/env python3
+"""Drive the DoorOS CLI in machine mode ("mode machine").
+
+Every command line gets one frame back:
+
+    SOH 'F' <status: 2 hex> <length: 8 hex> <crc32: 8 hex> LF <payload>
+
+This script switches the board to machine mode, runs each command (from the
+command line, or one per line on stdin), checks each frame's CRC and prints
+the payloads. It exits non-zero if any command returned a non-zero status.
+
+Examples:
+    tools/machine.py --tty /dev/ttyUSB0 currentuartsettings showinfo
+    tools/machine.py --pipe /tmp/dooros < setup.txt        (make run-pipe)
+"""
+
+import argparse
+import os
+import select
+import sys
+import time
+import zlib
+
+from baudswitch import Link
+
+FRAME_START = b"\x01F"
+HEADER_SIZE = 2 + 8 + 8 + 1  # status, length, crc, LF
+STATUS_TRUNCATED = 0x80
+
+
+class Machine:
+    """Command/response access to a board in machine mode."""
+
+    def __init__(self, link, timeout=10.0):
+        self.link = link
+        self.timeout = timeout
+        self.pending = b""
+
+    def fill(self, deadline):
+        left = deadline - time.monotonic()
+        if left <= 0 or not select.select([self.link.rfd], [], [], left)[0]:
+            raise TimeoutError("no complete frame from the board")
+        self.pending += os.read(self.link.rfd, 4096)
+
+    def read(self, count, deadline):
+        while len(self.pending) < count:
+            self.fill(deadline)
+        data, self.pending = self.pending[:count], self.pending[count:]
+        return data
+
+    def enter(self):
+        """Switch from the interactive CLI and discard its echo."""
+        self.link.write(b"\nmode machine\n")
+        time.sleep(0.2)
+        while select.select([self.link.rfd], [], [], 0.1)[0]:
+            os.read(self.link.rfd, 4096)
+        self.pending = self.link.pending = b""
+
+    def command(self, line):
+        """Run one command; return (status, payload bytes)."""
+        self.link.write(line.encode() + b"\n")
+        deadline = time.monotonic() + self.timeout
+
+        # Skip anything before the frame start (e.g. direct UART output)
+        while FRAME_START not in self.pending:
+            self.pending = self.pending[-1:]
+            self.fill(deadline)
+        self.pending = self.pending[self.pending.index(FRAME_START) + len(FRAME_START):]
+
+        header = self.read(HEADER_SIZE, deadline)
+        status = int(header[0:2], 16)
+        length = int(header[2:10], 16)
+        crc = int(header[10:18], 16)
+        payload = self.read(length, deadline)
+        if zlib.crc32(payload) != crc:
+            raise IOError("CRC mismatch in reply to %r" % line)
+        return status, payload
+
+
+def parse_records(payload):
+    """Turn key=value lines into a dict."""
+    records = {}
+    for line in payload.decode(errors="replace").splitlines():
+        key, sep, value = line.partition("=")
+        if sep:
+            records[key] = value
+    return records
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    where = parser.add_mutually_exclusive_group(required=True)
+    where.add_argument("--tty", help="serial device connected to UART0")
+    where.add_argument("--pipe", help="QEMU serial pipe path (without .in/.out)")
+    parser.add_argument("--baud", type=int, default=115200, help="console baud rate")
+    parser.add_argument("--timeout", type=float, default=10.0, help="seconds to wait per command")
+    parser.add_argument("--human", action="store_true", help="return to human mode when done")
+    parser.add_argument("command", nargs="*", help="commands to run (default: read stdin)")
+    args = parser.parse_args()
+
+    machine = Machine(Link(tty=args.tty, pipe=args.pipe, baud=args.baud), args.timeout)
+    machine.enter()
+
+    commands = args.command or [line.strip() for line in sys.stdin if line.strip()]
+    failed = 0
+    for line in commands:
+        status, payload = machine.command(line)
+        sys.stdout.write(payload.decode(errors="replace"))
+        if status:
+            failed += 1
+            print("%s: status %d%s" % (line, status & ~STATUS_TRUNCATED,
+                                       " (output truncated)" if status & STATUS_TRUNCATED else ""),
+                  file=sys.stderr)
+
+    if args.human:
+        machine.command("mode human")
+    sys.exit(1 if failed else 0)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,142 @@
+#!/usr/bin/env python3
+"""Symbolize a DoorOS sampling profile ("profile dump").
+
+The board prints the number of samples per core and call stack, innermost
+PC first (the stacks are one PC deep unless the kernel was built with
+"make FRAME_POINTERS=1"):
+
+    profile hz=997 samples=5012 dropped=0 depth=8
+    0 1234 80a1c 81f40 80b2c
+    ...
+    end
+
+This script maps each PC to the function containing it, using the symbol
+table of build/kernel8.elf (through nm), and prints a flat profile of the
+innermost functions sorted by samples. --folded writes one
+"core;outer;...;inner count" line per stack, the input format of
+flamegraph.pl and similar tools. The dump is read from a file
+(for example a terminal log), or fetched from the board in machine mode.
+
+Examples:
+    tools/profsym.py capture.log
+    tools/profsym.py --pipe /tmp/dooros --folded kernel.folded    (make run-pipe)
+    flamegraph.pl kernel.folded > kernel.svg
+"""
+
+import argparse
+import bisect
+import re
+import subprocess
+import sys
+
+HEADER = re.compile(r"^profile hz=(\d+) samples=(\d+) dropped=(\d+)")
+SAMPLE = re.compile(r"^(\d+) (\d+)((?: [0-9a-fA-F]+)+)$")
+
+
+def parse_dump(text):
+    """Return (header dict, [(core, count, [pc, caller, ...])]) for the last dump in text."""
+    header, samples, current = None, [], None
+    for line in text.splitlines():
+        line = line.strip()
+        match = HEADER.match(line)
+        if match:
+            header = {"hz": int(match.group(1)), "samples": int(match.group(2)),
+                      "dropped": int(match.group(3))}
+            current = []
+            continue
+        if current is None:
+            continue
+        if line == "end":
+            samples, current = current, None
+            continue
+        match = SAMPLE.match(line)
+        if match:
+            current.append((int(match.group(1)), int(match.group(2)),
+                            [int(pc, 16) for pc in match.group(3).split()]))
+    if header is None:
+        raise ValueError("no 'profile dump' output found")
+    if current is not None:
+        samples = current  # Dump cut short; use what arrived
+    return header, samples
+
+
+class Symbols:
+    """Function start addresses from the kernel ELF."""
+
+    def __init__(self, elf, nm):
+        output = subprocess.run([nm, "-n", "--defined-only", elf], check=True,
+                                capture_output=True, text=True).stdout
+        self.starts, self.names = [], []
+        for line in output.splitlines():
+            fields = line.split()
+            if len(fields) == 3 and fields[1] in "tTwW" and not fields[2].startswith("$"):
+                self.starts.append(int(fields[0], 16))
+                self.names.append(fields[2])
+
+    def lookup(self, pc):
+        if pc == 0:
+            return "[untracked]"
+        i = bisect.bisect_right(self.starts, pc) - 1
+        return self.names[i] if i >= 0 else "[unknown 0x%x]" % pc
+
+
+def fetch(args):
+    """Run 'profile dump' on the board in machine mode."""
+    from baudswitch import Link
+    from machine import Machine, STATUS_TRUNCATED
+
+    machine = Machine(Link(tty=args.tty, pipe=args.pipe, baud=args.baud))
+    machine.enter()
+    status, payload = machine.command("profile dump")
+    if status & STATUS_TRUNCATED:
+        print("warning: dump truncated by the machine mode capture buffer", file=sys.stderr)
+    return payload.decode(errors="replace")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("dump", nargs="?", help="file holding 'profile dump' output (- for stdin)")
+    parser.add_argument("--tty", help="fetch the dump over this serial device instead")
+    parser.add_argument("--pipe", help="fetch the dump over this QEMU serial pipe instead")
+    parser.add_argument("--baud", type=int, default=115200, help="console baud rate")
+    parser.add_argument("--elf", default="build/kernel8.elf", help="kernel with symbols")
+    parser.add_argument("--nm", default="aarch64-none-elf-nm", help="nm for the kernel's target")
+    parser.add_argument("--folded", help="write folded stacks for flamegraph.pl to this file")
+    parser.add_argument("--top", type=int, default=40, help="functions in the flat profile")
+    args = parser.parse_args()
+
+    if args.tty or args.pipe:
+        text = fetch(args)
+    elif args.dump:
+        text = sys.stdin.read() if args.dump == "-" else open(args.dump, errors="replace").read()
+    else:
+        parser.error("give a dump file, --tty or --pipe")
+
+    header, samples = parse_dump(text)
+    symbols = Symbols(args.elf, args.nm)
+
+    functions, folded = {}, {}
+    total = 0
+    for core, count, pcs in samples:
+        # Callers are return addresses, just past the call: look up the call itself
+        names = [symbols.lookup(pc if depth == 0 or pc == 0 else pc - 4) for depth, pc in enumerate(pcs)]
+        functions[names[0]] = functions.get(names[0], 0) + count
+        stack = ";".join(["core%d" % core] + names[::-1])
+        folded[stack] = folded.get(stack, 0) + count
+        total += count
+
+    print("%d samples at %d Hz, %d dropped" % (total, header["hz"], header["dropped"]))
+    print("%9s %7s  %s" % ("samples", "%", "function"))
+    ranked = sorted(functions.items(), key=lambda item: -item[1])
+    for name, count in ranked[:args.top]:
+        print("%9d %6.2f%%  %s" % (count, 100.0 * count / total if total else 0, name))
+
+    if args.folded:
+        with open(args.folded, "w") as out:
+            for stack, count in sorted(folded.items()):
+                out.write("%s %d\n" % (stack, count))
+
+
+if __name__ == "__main__":
+    main()
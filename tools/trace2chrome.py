@@ -0,0 +1,111 @@
+#!/usr/bin/env python3
+"""Convert a DoorOS function trace ("trace dump") to Chrome trace JSON.
+
+A kernel built with "make trace" records every function entry and exit;
+"trace dump" prints them per core, oldest first:
+
+    trace hz=62500000 records=4096
+    0 E 1a2b3c4d 80a1c
+    0 X 1a2b3d10 80a1c
+    ...
+    end
+
+This script names the functions from build/kernel8.elf (through nm) and
+writes the Trace Event Format read by chrome://tracing and ui.perfetto.dev,
+one thread per core. The ring only keeps the latest events, so exits whose
+entry was overwritten are dropped, and functions still running at the end
+are closed at the last timestamp.
+
+Capture the dump from a terminal log, or with semihosting:
+"output file trace.txt", "trace dump", "output uart".
+
+Example:
+    tools/trace2chrome.py trace.txt -o trace.json
+"""
+
+import argparse
+import json
+import re
+import sys
+
+from profsym import Symbols
+
+HEADER = re.compile(r"^trace hz=(\d+) records=(\d+)")
+RECORD = re.compile(r"^(\d+) ([EX]) ([0-9a-fA-F]+) ([0-9a-fA-F]+)$")
+
+
+def parse_dump(text):
+    """Return (timer frequency, [(core, enter, ticks, function)]) for the last dump in text."""
+    hz, records, current = None, [], None
+    for line in text.splitlines():
+        line = line.strip()
+        match = HEADER.match(line)
+        if match:
+            hz, current = int(match.group(1)), []
+            continue
+        if current is None:
+            continue
+        if line == "end":
+            records, current = current, None
+            continue
+        match = RECORD.match(line)
+        if match:
+            current.append((int(match.group(1)), match.group(2) == "E",
+                            int(match.group(3), 16), int(match.group(4), 16)))
+    if hz is None:
+        raise ValueError("no 'trace dump' output found")
+    return hz, current if current is not None else records
+
+
+def convert(hz, records, symbols):
+    """Build balanced B/E events per core, with timestamps in microseconds."""
+    events = []
+    start = min((ticks for _, _, ticks, _ in records), default=0)
+    stacks, last = {}, {}
+
+    for core, enter, ticks, function in records:
+        ts = (ticks - start) * 1e6 / hz
+        stack = stacks.setdefault(core, [])
+        last[core] = ts
+        if enter:
+            stack.append(function)
+            events.append({"name": symbols.lookup(function), "ph": "B", "ts": ts, "pid": 0, "tid": core})
+        elif function in stack:
+            # Close anything entered after it whose exit was not recorded
+            while stack:
+                open_function = stack.pop()
+                events.append({"name": symbols.lookup(open_function), "ph": "E", "ts": ts, "pid": 0,
+                               "tid": core})
+                if open_function == function:
+                    break
+
+    for core, stack in stacks.items():
+        while stack:
+            events.append({"name": symbols.lookup(stack.pop()), "ph": "E", "ts": last[core], "pid": 0,
+                           "tid": core})
+
+    for core in stacks:
+        events.append({"name": "thread_name", "ph": "M", "pid": 0, "tid": core, "args": {"name": "core %d" % core}})
+    return {"traceEvents": events, "displayTimeUnit": "ns"}
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("dump", help="file holding 'trace dump' output (- for stdin)")
+    parser.add_argument("-o", "--output", default="trace.json", help="JSON file to write")
+    parser.add_argument("--elf", default="build/kernel8.elf", help="kernel with symbols")
+    parser.add_argument("--nm", default="aarch64-none-elf-nm", help="nm for the kernel's target")
+    args = parser.parse_args()
+
+    text = sys.stdin.read() if args.dump == "-" else open(args.dump, errors="replace").read()
+    hz, records = parse_dump(text)
+    trace = convert(hz, records, Symbols(args.elf, args.nm))
+
+    with open(args.output, "w") as out:
+        json.dump(trace, out)
+    print("%d records, %d events written to %s" % (len(records), len(trace["traceEvents"]), args.output))
+
+
+if __name__ == "__main__":
+    main()